@@ -0,0 +1,142 @@
+// Copyright 2019-2021 the Deno authors. All rights reserved. MIT license.
+
+// Compares the `v8_struct!` conversions with hand-written code that creates
+// and reads the same objects one property at a time, the way most embedders
+// write it.
+
+use rusty_v8 as v8;
+use std::convert::TryFrom;
+use std::time::Instant;
+use v8::convert::FromV8;
+use v8::convert::ToV8;
+
+v8::v8_struct! {
+  struct Request {
+    id: u32,
+    method: String,
+    ok: bool,
+    latency: f64,
+    tags: Vec<String>,
+  }
+}
+
+const ITERATIONS: u32 = 500_000;
+
+fn hand_written_to_v8<'s>(
+  scope: &mut v8::HandleScope<'s>,
+  request: &Request,
+) -> v8::Local<'s, v8::Value> {
+  let object = v8::Object::new(scope);
+  let key = v8::String::new(scope, "id").unwrap().into();
+  let value = v8::Integer::new_from_unsigned(scope, request.id).into();
+  object.set(scope, key, value);
+  let key = v8::String::new(scope, "method").unwrap().into();
+  let value = v8::String::new(scope, &request.method).unwrap().into();
+  object.set(scope, key, value);
+  let key = v8::String::new(scope, "ok").unwrap().into();
+  let value = v8::Boolean::new(scope, request.ok).into();
+  object.set(scope, key, value);
+  let key = v8::String::new(scope, "latency").unwrap().into();
+  let value = v8::Number::new(scope, request.latency).into();
+  object.set(scope, key, value);
+  let tags = v8::Array::new(scope, request.tags.len() as i32);
+  for (index, tag) in request.tags.iter().enumerate() {
+    let tag = v8::String::new(scope, tag).unwrap().into();
+    tags.set_index(scope, index as u32, tag);
+  }
+  let key = v8::String::new(scope, "tags").unwrap().into();
+  object.set(scope, key, tags.into());
+  object.into()
+}
+
+fn hand_written_from_v8(
+  scope: &mut v8::HandleScope,
+  value: v8::Local<v8::Value>,
+) -> Request {
+  let object = v8::Local::<v8::Object>::try_from(value).unwrap();
+  let key = v8::String::new(scope, "id").unwrap().into();
+  let id = object.get(scope, key).unwrap().uint32_value(scope).unwrap();
+  let key = v8::String::new(scope, "method").unwrap().into();
+  let method = object.get(scope, key).unwrap().to_rust_string_lossy(scope);
+  let key = v8::String::new(scope, "ok").unwrap().into();
+  let ok = object.get(scope, key).unwrap().boolean_value(scope);
+  let key = v8::String::new(scope, "latency").unwrap().into();
+  let latency = object.get(scope, key).unwrap().number_value(scope).unwrap();
+  let key = v8::String::new(scope, "tags").unwrap().into();
+  let tags = object.get(scope, key).unwrap();
+  let tags = v8::Local::<v8::Array>::try_from(tags).unwrap();
+  let tags = (0..tags.length())
+    .map(|index| {
+      let tag = tags.get_index(scope, index).unwrap();
+      tag.to_rust_string_lossy(scope)
+    })
+    .collect();
+  Request {
+    id,
+    method,
+    ok,
+    latency,
+    tags,
+  }
+}
+
+fn report(name: &str, start: Instant) {
+  let elapsed = start.elapsed().as_secs_f64();
+  println!(
+    "{:<28} {:>12.0} ops/s {:>8.0} ns/op",
+    name,
+    ITERATIONS as f64 / elapsed,
+    elapsed * 1e9 / ITERATIONS as f64
+  );
+}
+
+fn main() {
+  let platform = v8::new_default_platform(0, false).make_shared();
+  v8::V8::initialize_platform(platform);
+  v8::V8::initialize();
+
+  let isolate = &mut v8::Isolate::new(Default::default());
+  let scope = &mut v8::HandleScope::new(isolate);
+  let context = v8::Context::new(scope);
+  let scope = &mut v8::ContextScope::new(scope, context);
+
+  let request = Request {
+    id: 42,
+    method: "op_read".to_string(),
+    ok: true,
+    latency: 0.25,
+    tags: vec!["fs".to_string(), "async".to_string()],
+  };
+
+  let start = Instant::now();
+  for _ in 0..ITERATIONS {
+    let scope = &mut v8::HandleScope::new(scope);
+    hand_written_to_v8(scope, &request);
+  }
+  report("to_v8 (hand-written)", start);
+
+  let start = Instant::now();
+  for _ in 0..ITERATIONS {
+    let scope = &mut v8::HandleScope::new(scope);
+    request.to_v8(scope).unwrap();
+  }
+  report("to_v8 (v8_struct!)", start);
+
+  let value = request.to_v8(scope).unwrap();
+
+  let start = Instant::now();
+  for _ in 0..ITERATIONS {
+    let scope = &mut v8::HandleScope::new(scope);
+    let request = hand_written_from_v8(scope, value);
+    assert_eq!(request.id, 42);
+  }
+  report("from_v8 (hand-written)", start);
+
+  let start = Instant::now();
+  for _ in 0..ITERATIONS {
+    let scope = &mut v8::HandleScope::new(scope);
+    let request = Request::from_v8(scope, value).unwrap();
+    assert_eq!(request.id, 42);
+  }
+  report("from_v8 (v8_struct!)", start);
+}
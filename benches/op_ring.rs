@@ -0,0 +1,122 @@
+// Copyright 2019-2021 the Deno authors. All rights reserved. MIT license.
+
+// Compares dispatching tiny operations from JavaScript to Rust with one
+// FunctionCallback per operation against batching them in an `OpRing` that
+// is drained by a single callback per batch.
+
+use rusty_v8 as v8;
+use std::cell::Cell;
+use std::time::Instant;
+
+const OPS: u32 = 10_000_000;
+
+thread_local! {
+  static SUM: Cell<u64> = Cell::new(0);
+}
+
+fn op_add(
+  scope: &mut v8::HandleScope,
+  args: v8::FunctionCallbackArguments,
+  _rv: v8::ReturnValue,
+) {
+  let a = args.get(0).uint32_value(scope).unwrap();
+  let b = args.get(1).uint32_value(scope).unwrap();
+  SUM.with(|sum| sum.set(sum.get() + a as u64 + b as u64));
+}
+
+fn op_drain(
+  scope: &mut v8::HandleScope,
+  _args: v8::FunctionCallbackArguments,
+  _rv: v8::ReturnValue,
+) {
+  let ring = scope.get_slot::<v8::OpRing>().unwrap();
+  let mut total = 0;
+  ring.drain(|record| {
+    let a = u32::from_le_bytes([record[0], record[1], record[2], record[3]]);
+    let b = u32::from_le_bytes([record[4], record[5], record[6], record[7]]);
+    total += a as u64 + b as u64;
+  });
+  SUM.with(|sum| sum.set(sum.get() + total));
+}
+
+fn set_global(
+  scope: &mut v8::HandleScope,
+  name: &str,
+  value: v8::Local<v8::Value>,
+) {
+  let global = scope.get_current_context().global(scope);
+  let key = v8::String::new(scope, name).unwrap();
+  global.set(scope, key.into(), value);
+}
+
+fn run(scope: &mut v8::HandleScope, name: &str, source: &str) {
+  SUM.with(|sum| sum.set(0));
+  let source = v8::String::new(scope, source).unwrap();
+  let script = v8::Script::compile(scope, source, None).unwrap();
+  let start = Instant::now();
+  script.run(scope).unwrap();
+  let elapsed = start.elapsed().as_secs_f64();
+  let expected = (OPS as u64 - 1) * OPS as u64 / 2 + OPS as u64;
+  assert_eq!(SUM.with(|sum| sum.get()), expected);
+  println!(
+    "{:<28} {:>12.0} ops/s {:>8.1} ns/op",
+    name,
+    OPS as f64 / elapsed,
+    elapsed * 1e9 / OPS as f64
+  );
+}
+
+fn main() {
+  let platform = v8::new_default_platform(0, false).make_shared();
+  v8::V8::initialize_platform(platform);
+  v8::V8::initialize();
+
+  let isolate = &mut v8::Isolate::new(Default::default());
+  let ring = v8::OpRing::new(isolate, 1024, 8);
+  let scope = &mut v8::HandleScope::new(isolate);
+  let context = v8::Context::new(scope);
+  let scope = &mut v8::ContextScope::new(scope, context);
+
+  let function = v8::Function::new(scope, op_add).unwrap();
+  set_global(scope, "opAdd", function.into());
+  let function = v8::Function::new(scope, op_drain).unwrap();
+  set_global(scope, "opDrain", function.into());
+  let sab = ring.shared_array_buffer(scope);
+  set_global(scope, "sab", sab.into());
+  let source = v8::String::new(scope, v8::OpRing::JS_SOURCE).unwrap();
+  let script = v8::Script::compile(scope, source, None).unwrap();
+  let class = script.run(scope).unwrap();
+  set_global(scope, "OpRing", class);
+  scope.set_slot(ring);
+
+  run(
+    scope,
+    "direct callbacks",
+    &format!("for (let i = 0; i < {}; i++) opAdd(i, 1);", OPS),
+  );
+
+  run(
+    scope,
+    "op ring (1024 per drain)",
+    &format!(
+      r#"{{
+        const ring = new OpRing(sab);
+        const u32 = new Uint32Array(sab);
+        for (let i = 0; i < {}; i++) {{
+          let offset = ring.reserve();
+          if (offset < 0) {{
+            ring.flush();
+            opDrain();
+            offset = ring.reserve();
+          }}
+          u32[offset >> 2] = i;
+          u32[(offset >> 2) + 1] = 1;
+          ring.commit();
+        }}
+        ring.flush();
+        opDrain();
+      }}"#,
+      OPS
+    ),
+  );
+}
@@ -0,0 +1,96 @@
+// Copyright 2019-2021 the Deno authors. All rights reserved. MIT license.
+
+// Compares resolving a batch of promises from Rust one resolver at a time
+// (followed by a microtask checkpoint per batch) against
+// `PromiseResolver::resolve_all()`, which settles the whole batch and runs
+// the checkpoint in a single call.
+
+use rusty_v8 as v8;
+use std::convert::TryFrom;
+use std::time::Instant;
+
+const BATCH: usize = 1000;
+const BATCHES: usize = 1000;
+
+fn pending_resolvers(
+  scope: &mut v8::HandleScope,
+  track: v8::Local<v8::Function>,
+) -> Vec<v8::Global<v8::PromiseResolver>> {
+  let recv = v8::undefined(scope).into();
+  (0..BATCH)
+    .map(|_| {
+      let resolver = v8::PromiseResolver::new(scope).unwrap();
+      let promise = resolver.get_promise(scope);
+      track.call(scope, recv, &[promise.into()]).unwrap();
+      v8::Global::new(scope, resolver)
+    })
+    .collect()
+}
+
+fn run(
+  scope: &mut v8::HandleScope,
+  track: v8::Local<v8::Function>,
+  name: &str,
+  resolve: impl Fn(
+    &mut v8::HandleScope,
+    &[(v8::Global<v8::PromiseResolver>, v8::Local<v8::Value>)],
+  ),
+) {
+  let mut elapsed = 0.0;
+  for _ in 0..BATCHES {
+    let scope = &mut v8::HandleScope::new(scope);
+    // Creating the promises isn't part of the measurement.
+    let resolvers = pending_resolvers(scope, track);
+    let start = Instant::now();
+    let completions = resolvers
+      .into_iter()
+      .enumerate()
+      .map(|(i, resolver)| (resolver, v8::Integer::new(scope, i as i32).into()))
+      .collect::<Vec<_>>();
+    resolve(scope, &completions);
+    elapsed += start.elapsed().as_secs_f64();
+  }
+  let completions = BATCH * BATCHES;
+  println!(
+    "{:<20} {:>12.0} completions/s {:>8.1} ns/completion",
+    name,
+    completions as f64 / elapsed,
+    elapsed * 1e9 / completions as f64
+  );
+}
+
+fn main() {
+  let platform = v8::new_default_platform(0, false).make_shared();
+  v8::V8::initialize_platform(platform);
+  v8::V8::initialize();
+
+  let isolate = &mut v8::Isolate::new(Default::default());
+  isolate.set_microtasks_policy(v8::MicrotasksPolicy::Explicit);
+  let scope = &mut v8::HandleScope::new(isolate);
+  let context = v8::Context::new(scope);
+  let scope = &mut v8::ContextScope::new(scope, context);
+
+  let source = v8::String::new(
+    scope,
+    "globalThis.sum = 0; (p) => p.then((v) => { sum += v; })",
+  )
+  .unwrap();
+  let script = v8::Script::compile(scope, source, None).unwrap();
+  let track = script.run(scope).unwrap();
+  let track = v8::Local::<v8::Function>::try_from(track).unwrap();
+
+  run(scope, track, "per promise", |scope, completions| {
+    for (resolver, value) in completions {
+      let resolver = v8::Local::new(scope, resolver);
+      resolver.resolve(scope, *value).unwrap();
+    }
+    scope.perform_microtask_checkpoint();
+  });
+
+  run(scope, track, "resolve_all", |scope, completions| {
+    assert_eq!(
+      v8::PromiseResolver::resolve_all(scope, completions),
+      completions.len()
+    );
+  });
+}
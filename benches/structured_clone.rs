@@ -0,0 +1,267 @@
+// Copyright 2019-2021 the Deno authors. All rights reserved. MIT license.
+
+// Measures ValueSerializer / ValueDeserializer throughput for a number of
+// payload shapes. For every shape and direction it reports messages/sec, MB/s
+// of serialized data, and the number of Rust heap allocations per message.
+// Allocations made by V8 itself are not visible to the counting allocator.
+
+use rusty_v8 as v8;
+use std::alloc::GlobalAlloc;
+use std::alloc::Layout;
+use std::alloc::System;
+use std::convert::TryFrom;
+use std::sync::atomic::AtomicUsize;
+use std::sync::atomic::Ordering;
+use std::time::Instant;
+
+struct CountingAllocator;
+
+static ALLOCATIONS: AtomicUsize = AtomicUsize::new(0);
+
+unsafe impl GlobalAlloc for CountingAllocator {
+  unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+    ALLOCATIONS.fetch_add(1, Ordering::Relaxed);
+    System.alloc(layout)
+  }
+
+  unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+    System.dealloc(ptr, layout)
+  }
+
+  unsafe fn realloc(
+    &self,
+    ptr: *mut u8,
+    layout: Layout,
+    new_size: usize,
+  ) -> *mut u8 {
+    ALLOCATIONS.fetch_add(1, Ordering::Relaxed);
+    System.realloc(ptr, layout, new_size)
+  }
+}
+
+#[global_allocator]
+static GLOBAL: CountingAllocator = CountingAllocator;
+
+/// A minimal delegate for the host-object payload: every ArrayBufferView is
+/// written as its length followed by its bytes, and comes back as a
+/// Uint8Array. The bytes are copied through a scratch buffer that is reused
+/// across messages. The other payloads never reach it.
+///
+/// Clone errors are thrown as exceptions and reported once the serializer has
+/// returned: the delegate is called from C++, which a panic must not unwind
+/// through.
+#[derive(Default)]
+struct Delegate {
+  scratch: Vec<u8>,
+}
+
+impl v8::ValueSerializerImpl for Delegate {
+  fn throw_data_clone_error<'s>(
+    &mut self,
+    scope: &mut v8::HandleScope<'s>,
+    message: v8::Local<'s, v8::String>,
+  ) {
+    let error = v8::Exception::error(scope, message);
+    scope.throw_exception(error);
+  }
+
+  fn write_host_object<'s>(
+    &mut self,
+    _scope: &mut v8::HandleScope<'s>,
+    object: v8::Local<'s, v8::Object>,
+    value_serializer: &mut dyn v8::ValueSerializerHelper,
+  ) -> Option<bool> {
+    let view = v8::Local::<v8::ArrayBufferView>::try_from(object).unwrap();
+    self.scratch.resize(view.byte_length(), 0);
+    view.copy_contents(&mut self.scratch);
+    value_serializer.write_uint32(self.scratch.len() as u32);
+    value_serializer.write_raw_bytes(&self.scratch);
+    Some(true)
+  }
+}
+
+impl v8::ValueDeserializerImpl for Delegate {
+  fn read_host_object<'s>(
+    &mut self,
+    scope: &mut v8::HandleScope<'s>,
+    value_deserializer: &mut dyn v8::ValueDeserializerHelper,
+  ) -> Option<v8::Local<'s, v8::Object>> {
+    let mut length = 0;
+    assert!(value_deserializer.read_uint32(&mut length));
+    let backing_store = value_deserializer
+      .read_raw_bytes_as_backing_store(length as usize)?
+      .make_shared();
+    let buffer = v8::ArrayBuffer::with_backing_store(scope, &backing_store);
+    v8::Uint8Array::new(scope, buffer, 0, length as usize).map(Into::into)
+  }
+}
+
+#[derive(Clone, Copy, PartialEq)]
+enum Mode {
+  Plain,
+  HostObjects,
+  TransferArrayBuffer,
+}
+
+struct Payload {
+  name: &'static str,
+  source: &'static str,
+  mode: Mode,
+  iterations: u64,
+}
+
+const PAYLOADS: &[Payload] = &[
+  Payload {
+    name: "small object",
+    source: "({ id: 1, method: 'ping', ok: true, tags: ['a', 'b'] })",
+    mode: Mode::Plain,
+    iterations: 500_000,
+  },
+  Payload {
+    name: "deep nesting (100 levels)",
+    source: r#"{
+      let o = { leaf: true };
+      for (let i = 0; i < 100; i++) o = { i, child: o };
+      o
+    }"#,
+    mode: Mode::Plain,
+    iterations: 50_000,
+  },
+  Payload {
+    name: "large typed array (1 MiB)",
+    source: "new Uint8Array(1 << 20).fill(7)",
+    mode: Mode::Plain,
+    iterations: 2_000,
+  },
+  Payload {
+    name: "host objects (16 x 1 KiB views)",
+    source: "Array.from({ length: 16 }, () => new Uint8Array(1024))",
+    mode: Mode::HostObjects,
+    iterations: 50_000,
+  },
+  Payload {
+    name: "transferred ArrayBuffer (1 MiB)",
+    source: "new ArrayBuffer(1 << 20)",
+    mode: Mode::TransferArrayBuffer,
+    iterations: 200_000,
+  },
+];
+
+fn report(
+  name: &str,
+  direction: &str,
+  iterations: u64,
+  message_size: usize,
+  start: Instant,
+  allocations: usize,
+) {
+  let elapsed = start.elapsed().as_secs_f64();
+  let messages_per_sec = iterations as f64 / elapsed;
+  let mb_per_sec =
+    (message_size as f64 * iterations as f64) / elapsed / (1024.0 * 1024.0);
+  println!(
+    "{:<34} {:<12} {:>12.0} msg/s {:>10.1} MB/s {:>8.2} allocs/msg",
+    name,
+    direction,
+    messages_per_sec,
+    mb_per_sec,
+    allocations as f64 / iterations as f64
+  );
+}
+
+fn run(scope: &mut v8::HandleScope, payload: &Payload) {
+  let context = scope.get_current_context();
+  let source = v8::String::new(scope, payload.source).unwrap();
+  let value = v8::Script::compile(scope, source, None)
+    .unwrap()
+    .run(scope)
+    .unwrap();
+  let transferred = v8::Local::<v8::ArrayBuffer>::try_from(value).ok();
+  let transferred_backing_store = transferred.map(|ab| ab.get_backing_store());
+
+  let serialize = |scope: &mut v8::HandleScope| {
+    use v8::ValueSerializerHelper;
+    let scope = &mut v8::TryCatch::new(scope);
+    let mut serializer =
+      v8::ValueSerializer::new(scope, Box::new(Delegate::default()));
+    serializer.write_header();
+    match payload.mode {
+      Mode::Plain => {}
+      Mode::HostObjects => {
+        serializer.set_treat_array_buffer_views_as_host_objects(true)
+      }
+      Mode::TransferArrayBuffer => {
+        serializer.transfer_array_buffer(0, transferred.unwrap())
+      }
+    }
+    if serializer.write_value(context, value) == Some(true) {
+      return serializer.release();
+    }
+    drop(serializer);
+    let exception = scope.exception().unwrap();
+    panic!("{}", exception.to_rust_string_lossy(scope));
+  };
+
+  let message = serialize(scope);
+  let message_size = message.len();
+
+  let allocations = ALLOCATIONS.load(Ordering::Relaxed);
+  let start = Instant::now();
+  for _ in 0..payload.iterations {
+    let scope = &mut v8::HandleScope::new(scope);
+    let buffer = serialize(scope);
+    assert_eq!(buffer.len(), message_size);
+  }
+  let allocations = ALLOCATIONS.load(Ordering::Relaxed) - allocations;
+  report(
+    payload.name,
+    "serialize",
+    payload.iterations,
+    message_size,
+    start,
+    allocations,
+  );
+
+  let allocations = ALLOCATIONS.load(Ordering::Relaxed);
+  let start = Instant::now();
+  for _ in 0..payload.iterations {
+    use v8::ValueDeserializerHelper;
+    let scope = &mut v8::HandleScope::new(scope);
+    let mut deserializer = v8::ValueDeserializer::new(
+      scope,
+      Box::new(Delegate::default()),
+      &message,
+    );
+    assert_eq!(deserializer.read_header(context), Some(true));
+    if let Some(backing_store) = &transferred_backing_store {
+      let array_buffer =
+        v8::ArrayBuffer::with_backing_store(scope, backing_store);
+      deserializer.transfer_array_buffer(0, array_buffer);
+    }
+    assert!(deserializer.read_value(context).is_some());
+  }
+  let allocations = ALLOCATIONS.load(Ordering::Relaxed) - allocations;
+  report(
+    payload.name,
+    "deserialize",
+    payload.iterations,
+    message_size,
+    start,
+    allocations,
+  );
+}
+
+fn main() {
+  let platform = v8::new_default_platform(0, false).make_shared();
+  v8::V8::initialize_platform(platform);
+  v8::V8::initialize();
+
+  let isolate = &mut v8::Isolate::new(Default::default());
+  let scope = &mut v8::HandleScope::new(isolate);
+  let context = v8::Context::new(scope);
+  let scope = &mut v8::ContextScope::new(scope, context);
+
+  for payload in PAYLOADS {
+    run(scope, payload);
+  }
+}
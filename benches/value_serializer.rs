@@ -0,0 +1,70 @@
+// Copyright 2019-2021 the Deno authors. All rights reserved. MIT license.
+use rusty_v8 as v8;
+use std::time::Instant;
+
+struct Serializer;
+
+impl v8::ValueSerializerImpl for Serializer {
+  fn throw_data_clone_error<'s>(
+    &mut self,
+    scope: &mut v8::HandleScope<'s>,
+    message: v8::Local<'s, v8::String>,
+  ) {
+    let error = v8::Exception::error(scope, message);
+    scope.throw_exception(error);
+  }
+}
+
+fn bench<F: FnMut()>(name: &str, iterations: u64, mut f: F) {
+  let start = Instant::now();
+  for _ in 0..iterations {
+    f();
+  }
+  let elapsed = start.elapsed();
+  let per_sec = iterations as f64 / elapsed.as_secs_f64();
+  println!(
+    "{:<40} {:>12.0} messages/sec {:>10.1} ns/message",
+    name,
+    per_sec,
+    elapsed.as_nanos() as f64 / iterations as f64
+  );
+}
+
+fn main() {
+  let platform = v8::new_default_platform(0, false).make_shared();
+  v8::V8::initialize_platform(platform);
+  v8::V8::initialize();
+
+  let isolate = &mut v8::Isolate::new(Default::default());
+  let scope = &mut v8::HandleScope::new(isolate);
+  let context = v8::Context::new(scope);
+  let scope = &mut v8::ContextScope::new(scope, context);
+
+  let code = v8::String::new(
+    scope,
+    "({ id: 42, method: 'ping', params: [1, 2, 3], ok: true })",
+  )
+  .unwrap();
+  let message = v8::Script::compile(scope, code, None)
+    .unwrap()
+    .run(scope)
+    .unwrap();
+
+  const N: u64 = 1_000_000;
+
+  bench("small message, new serializer", N, || {
+    let scope = &mut v8::HandleScope::new(scope);
+    let mut serializer = v8::ValueSerializer::new(scope, Box::new(Serializer));
+    serializer.write_value(context, message).unwrap();
+    let buffer = serializer.release();
+    assert!(!buffer.is_empty());
+  });
+
+  let mut serializer = v8::ValueSerializer::new(scope, Box::new(Serializer));
+  bench("small message, reused serializer", N, || {
+    serializer.write_value(context, message).unwrap();
+    let buffer = serializer.release_and_reset();
+    assert!(!buffer.is_empty());
+    serializer.recycle_buffer(buffer);
+  });
+}
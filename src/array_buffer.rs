@@ -54,6 +54,11 @@ extern "C" {
   fn v8__BackingStore__ByteLength(this: *const BackingStore) -> usize;
   fn v8__BackingStore__IsShared(this: *const BackingStore) -> bool;
   fn v8__BackingStore__DELETE(this: *mut BackingStore);
+  fn v8__BackingStore__Reallocate(
+    isolate: *mut Isolate,
+    this: *mut BackingStore,
+    byte_length: usize,
+  ) -> *mut BackingStore;
 
   fn std__shared_ptr__v8__BackingStore__COPY(
     ptr: *const SharedPtrBase<BackingStore>,
@@ -274,6 +279,34 @@ impl BackingStore {
   pub fn is_shared(&self) -> bool {
     unsafe { v8__BackingStore__IsShared(self) }
   }
+
+  /// Resizes `backing_store` to `byte_length` bytes using the
+  /// `ArrayBuffer::Allocator` of `isolate`. The contents are preserved up to
+  /// the smaller of the two lengths, and new memory is zero-initialized.
+  ///
+  /// Depending on the allocator the memory is resized in place, remapped,
+  /// or copied to a new allocation; the built-in `PoolAllocator` avoids
+  /// copying wherever it can. This makes it cheap to build up data of
+  /// unknown size (e.g. a streamed body) in a backing store before an
+  /// ArrayBuffer or SharedArrayBuffer is created from it.
+  ///
+  /// Only backing stores that were allocated by the isolate's allocator (see
+  /// `ArrayBuffer::new_backing_store()` and
+  /// `SharedArrayBuffer::new_backing_store()`) can be reallocated; V8
+  /// aborts the process for other backing stores, or if the allocator fails.
+  pub fn reallocate(
+    isolate: &mut Isolate,
+    backing_store: UniqueRef<BackingStore>,
+    byte_length: usize,
+  ) -> UniqueRef<BackingStore> {
+    unsafe {
+      UniqueRef::from_raw(v8__BackingStore__Reallocate(
+        isolate,
+        backing_store.into_raw(),
+        byte_length,
+      ))
+    }
+  }
 }
 
 impl Deref for BackingStore {
@@ -418,4 +451,139 @@ impl ArrayBuffer {
       ))
     }
   }
+
+  /// Returns a new standalone BackingStore for memory that is owned by the
+  /// embedder. `deleter` is called with `data`, `byte_length` and
+  /// `deleter_data` when the backing store is destroyed.
+  pub(crate) unsafe fn new_backing_store_from_raw_parts(
+    data: *mut c_void,
+    byte_length: usize,
+    deleter: BackingStoreDeleterCallback,
+    deleter_data: *mut c_void,
+  ) -> UniqueRef<BackingStore> {
+    UniqueRef::from_raw(v8__ArrayBuffer__NewBackingStore__with_data(
+      data,
+      byte_length,
+      deleter,
+      deleter_data,
+    ))
+  }
+
+  /// Returns a new standalone BackingStore that maps `byte_length` bytes of
+  /// `file`, starting at `offset`, into memory instead of reading them. The
+  /// pages are loaded lazily by the kernel as they are accessed, so even
+  /// very large files can be exposed to JavaScript cheaply. `offset` doesn't
+  /// need to be page-aligned. The mapping is removed (`munmap()`) when the
+  /// backing store is destroyed; `file` itself may be closed right away.
+  ///
+  /// With `FileMapMode::CopyOnWrite` writes from JavaScript go to private
+  /// copies of the touched pages and never reach the file. With
+  /// `FileMapMode::ReadOnly` no private copies are ever made, but the
+  /// memory is mapped read-only.
+  ///
+  /// `advice` is passed to `madvise()` to tune the kernel's read-ahead for
+  /// the expected access pattern.
+  ///
+  /// Like any other backing store, V8 accounts for the mapped length as
+  /// external memory of the isolate once an ArrayBuffer is created from it,
+  /// which makes the GC collect unreachable mappings in a timely manner.
+  ///
+  /// # Safety
+  ///
+  /// - With `FileMapMode::ReadOnly`, the buffer must never be written to
+  ///   (by JavaScript or by Rust); doing so crashes the process.
+  /// - The file must not be truncated while the mapping exists; accessing a
+  ///   page past the end of the file raises SIGBUS.
+  /// - With `FileMapMode::ReadOnly`, and for pages that haven't been copied
+  ///   yet with `FileMapMode::CopyOnWrite`, changes made to the file by
+  ///   other processes become visible through the buffer.
+  #[cfg(unix)]
+  pub unsafe fn new_backing_store_from_file(
+    file: &std::fs::File,
+    offset: u64,
+    byte_length: usize,
+    mode: FileMapMode,
+    advice: FileMapAdvice,
+  ) -> std::io::Result<UniqueRef<BackingStore>> {
+    use std::convert::TryInto;
+    use std::io::Error;
+    use std::io::ErrorKind;
+    use std::os::unix::io::AsRawFd;
+
+    if byte_length == 0 {
+      return Ok(Self::new_backing_store_from_boxed_slice(Box::new([])));
+    }
+
+    let page_size = libc::sysconf(libc::_SC_PAGESIZE) as u64;
+    let page_offset = (offset % page_size) as usize;
+    let map_offset: libc::off_t = (offset - page_offset as u64)
+      .try_into()
+      .map_err(|_| Error::from(ErrorKind::InvalidInput))?;
+    let map_length = byte_length + page_offset;
+    let protection = match mode {
+      FileMapMode::ReadOnly => libc::PROT_READ,
+      FileMapMode::CopyOnWrite => libc::PROT_READ | libc::PROT_WRITE,
+    };
+    let base = libc::mmap(
+      null_mut(),
+      map_length,
+      protection,
+      libc::MAP_PRIVATE,
+      file.as_raw_fd(),
+      map_offset,
+    );
+    if base == libc::MAP_FAILED {
+      return Err(Error::last_os_error());
+    }
+    let advice = match advice {
+      FileMapAdvice::Normal => libc::MADV_NORMAL,
+      FileMapAdvice::Sequential => libc::MADV_SEQUENTIAL,
+      FileMapAdvice::Random => libc::MADV_RANDOM,
+      FileMapAdvice::WillNeed => libc::MADV_WILLNEED,
+    };
+    // The advice is only a hint, so failures are ignored.
+    libc::madvise(base, map_length, advice);
+
+    unsafe extern "C" fn unmap(
+      data: *mut c_void,
+      byte_length: usize,
+      page_offset: *mut c_void,
+    ) {
+      let page_offset = page_offset as usize;
+      let base = (data as *mut u8).sub(page_offset);
+      libc::munmap(base as *mut c_void, byte_length + page_offset);
+    }
+
+    Ok(Self::new_backing_store_from_raw_parts(
+      (base as *mut u8).add(page_offset) as *mut c_void,
+      byte_length,
+      unmap,
+      page_offset as *mut c_void,
+    ))
+  }
+}
+
+/// How `ArrayBuffer::new_backing_store_from_file()` maps a file.
+#[derive(Clone, Copy, Debug, PartialEq)]
+pub enum FileMapMode {
+  /// The pages are shared with the page cache and can't be written to.
+  ReadOnly,
+  /// The pages are shared with the page cache until they are written to,
+  /// at which point they are copied. Writes are never written back to the
+  /// file.
+  CopyOnWrite,
+}
+
+/// The expected access pattern for a file mapped with
+/// `ArrayBuffer::new_backing_store_from_file()`, see `madvise(2)`.
+#[derive(Clone, Copy, Debug, PartialEq)]
+pub enum FileMapAdvice {
+  /// No special treatment.
+  Normal,
+  /// Pages will be accessed in order; read ahead aggressively.
+  Sequential,
+  /// Pages will be accessed in random order; don't read ahead.
+  Random,
+  /// The whole region will be accessed soon; start reading it now.
+  WillNeed,
 }
@@ -1,5 +1,8 @@
 use std::convert::TryInto;
 use std::ffi::c_void;
+use std::ptr::null_mut;
+use std::ptr::NonNull;
+use std::slice;
 
 use crate::support::int;
 use crate::ArrayBuffer;
@@ -18,6 +21,11 @@ extern "C" {
     dest: *mut c_void,
     byte_length: int,
   ) -> usize;
+  fn v8__ArrayBufferView__GetContents(
+    this: *const ArrayBufferView,
+    data: *mut *mut c_void,
+    byte_length: *mut usize,
+  ) -> bool;
 }
 
 impl ArrayBufferView {
@@ -52,4 +60,61 @@ impl ArrayBufferView {
       )
     }
   }
+
+  /// Returns the contents of the view without copying them, or None if the
+  /// view is backed by a SharedArrayBuffer, whose memory may be modified by
+  /// other threads at any time. The contents of a detached buffer are empty.
+  ///
+  /// Unlike `buffer()` followed by `ArrayBuffer::get_backing_store()`, this
+  /// crosses the FFI boundary once and doesn't leave a reference to the
+  /// backing store behind that needs to be released from Rust.
+  ///
+  /// The returned slice borrows `scope` mutably, so no JavaScript can run
+  /// while it is in use.
+  ///
+  /// # Safety
+  ///
+  /// The buffer must not be detached (e.g. with `ArrayBuffer::detach()`),
+  /// and its contents must not be written through any other means, while the
+  /// returned slice is alive.
+  pub unsafe fn get_contents<'a>(
+    &'a self,
+    scope: &'a mut HandleScope,
+  ) -> Option<&'a [u8]> {
+    let (data, byte_length) = self.get_contents_raw(scope)?;
+    Some(slice::from_raw_parts(data.as_ptr(), byte_length))
+  }
+
+  /// Mutable version of `get_contents()`.
+  ///
+  /// # Safety
+  ///
+  /// The buffer must not be detached while the returned slice is alive, and
+  /// its contents must not be accessed through any other means, including
+  /// other views of the same buffer.
+  pub unsafe fn get_contents_mut<'a>(
+    &'a self,
+    scope: &'a mut HandleScope,
+  ) -> Option<&'a mut [u8]> {
+    let (data, byte_length) = self.get_contents_raw(scope)?;
+    Some(slice::from_raw_parts_mut(data.as_ptr(), byte_length))
+  }
+
+  fn get_contents_raw(
+    &self,
+    _scope: &mut HandleScope,
+  ) -> Option<(NonNull<u8>, usize)> {
+    let mut data = null_mut();
+    let mut byte_length = 0;
+    let ok = unsafe {
+      v8__ArrayBufferView__GetContents(self, &mut data, &mut byte_length)
+    };
+    if !ok {
+      return None;
+    }
+    match NonNull::new(data as *mut u8) {
+      Some(data) => Some((data, byte_length)),
+      None => Some((NonNull::dangling(), 0)),
+    }
+  }
 }
@@ -0,0 +1,97 @@
+// Copyright 2019-2021 the Deno authors. All rights reserved. MIT license.
+
+use std::convert::TryFrom;
+
+use crate::Global;
+use crate::HandleScope;
+use crate::Local;
+use crate::Name;
+use crate::Object;
+use crate::Symbol;
+use crate::Value;
+
+/// A variable whose value follows the logical flow of async code, like
+/// Node's `AsyncLocalStorage`: a value set with `run()` is seen by `get()`
+/// inside the callback and in every promise reaction (`then()` callback or
+/// `await` continuation) created while it runs, however late that reaction
+/// is eventually executed.
+///
+/// The current values of all variables are kept in a frame object that is
+/// stored as the context's continuation-preserved embedder data, which V8
+/// captures when a promise reaction is created and restores while it runs.
+/// Unlike an implementation based on `Isolate::set_promise_hook()`, this
+/// costs nothing per promise: entering a `run()` allocates one frame object
+/// and `get()` is a property lookup.
+///
+/// ```ignore
+/// let request_id = v8::AsyncContextVariable::new(scope);
+/// request_id.run(scope, id.into(), |scope| {
+///   // Any promise chain started by `handler` sees the same request id.
+///   handler.call(scope, recv, &[]);
+/// });
+/// // ...and in a FunctionCallback called from that promise chain:
+/// let id = request_id.get(scope);
+/// ```
+#[derive(Clone)]
+pub struct AsyncContextVariable {
+  key: Global<Symbol>,
+}
+
+impl AsyncContextVariable {
+  pub fn new(scope: &mut HandleScope<()>) -> Self {
+    let key = Symbol::new(scope, None);
+    Self {
+      key: Global::new(scope, key),
+    }
+  }
+
+  /// Returns the value of the variable in the current async context, or
+  /// None if no enclosing `run()` has set it.
+  pub fn get<'s>(
+    &self,
+    scope: &mut HandleScope<'s>,
+  ) -> Option<Local<'s, Value>> {
+    let context = scope.get_current_context();
+    let frame = context.get_continuation_preserved_embedder_data(scope);
+    if !frame.is_object() {
+      return None;
+    }
+    let frame = Local::<Object>::try_from(frame).unwrap();
+    let key = Local::new(scope, &self.key);
+    let value = frame.get(scope, key.into())?;
+    if value.is_undefined() {
+      None
+    } else {
+      Some(value)
+    }
+  }
+
+  /// Calls `f` with the variable set to `value` in a new async context that
+  /// inherits the values of all other variables, then restores the previous
+  /// async context.
+  pub fn run<'s, R>(
+    &self,
+    scope: &mut HandleScope<'s>,
+    value: Local<Value>,
+    f: impl FnOnce(&mut HandleScope<'s>) -> R,
+  ) -> R {
+    let context = scope.get_current_context();
+    let previous = context.get_continuation_preserved_embedder_data(scope);
+    // Frames are never modified once they have been captured, so a new frame
+    // is derived from the current one through its prototype chain rather
+    // than by copying it.
+    let prototype = if previous.is_object() {
+      previous
+    } else {
+      crate::null(scope).into()
+    };
+    let key = Local::new(scope, &self.key);
+    let names: [Local<Name>; 1] = [key.into()];
+    let frame =
+      Object::with_prototype_and_properties(scope, prototype, &names, &[value]);
+    context.set_continuation_preserved_embedder_data(frame.into());
+    let result = f(scope);
+    context.set_continuation_preserved_embedder_data(previous);
+    result
+  }
+}
@@ -1,4 +1,5 @@
 // Copyright 2019-2021 the Deno authors. All rights reserved. MIT license.
+#include <algorithm>
 #include <cassert>
 #include <cstdint>
 #include <iostream>
@@ -10,7 +11,9 @@
 #include "v8/include/v8-platform.h"
 #include "v8/include/v8-profiler.h"
 #include "v8/include/v8.h"
+#include "v8/src/debug/debug-interface.h"
 #include "v8/src/execution/isolate-utils-inl.h"
+#include "v8/src/execution/isolate.h"
 #include "v8/src/execution/isolate-utils.h"
 #include "v8/src/flags/flags.h"
 #include "v8/src/objects/objects-inl.h"
@@ -226,6 +229,33 @@ void v8__Isolate__EnqueueMicrotask(v8::Isolate* isolate,
   isolate->EnqueueMicrotask(ptr_to_local(&function));
 }
 
+v8::MicrotaskQueue* v8__MicrotaskQueue__New(v8::Isolate* isolate,
+                                            v8::MicrotasksPolicy policy) {
+  return v8::MicrotaskQueue::New(isolate, policy).release();
+}
+
+void v8__MicrotaskQueue__DELETE(v8::MicrotaskQueue* self) { delete self; }
+
+void v8__MicrotaskQueue__PerformCheckpoint(v8::Isolate* isolate,
+                                           v8::MicrotaskQueue* self) {
+  self->PerformCheckpoint(isolate);
+}
+
+bool v8__MicrotaskQueue__IsRunningMicrotasks(const v8::MicrotaskQueue& self) {
+  return self.IsRunningMicrotasks();
+}
+
+int v8__MicrotaskQueue__GetMicrotasksScopeDepth(
+    const v8::MicrotaskQueue& self) {
+  return self.GetMicrotasksScopeDepth();
+}
+
+void v8__MicrotaskQueue__EnqueueMicrotask(v8::Isolate* isolate,
+                                          v8::MicrotaskQueue* self,
+                                          const v8::Function& callback) {
+  self->EnqueueMicrotask(isolate, ptr_to_local(&callback));
+}
+
 void v8__Isolate__RequestInterrupt(v8::Isolate* isolate,
                                    v8::InterruptCallback callback, void* data) {
   isolate->RequestInterrupt(callback, data);
@@ -307,6 +337,17 @@ void v8__Isolate__SetAllowAtomicsWait(v8::Isolate* isolate, bool allow) {
   isolate->SetAllowAtomicsWait(allow);
 }
 
+void v8__Isolate__SetAtomicsWaitCallback(
+    v8::Isolate* isolate, v8::Isolate::AtomicsWaitCallback callback,
+    void* data) {
+  isolate->SetAtomicsWaitCallback(callback, data);
+}
+
+void v8__Isolate__AtomicsWaitWakeHandle__Wake(
+    v8::Isolate::AtomicsWaitWakeHandle* self) {
+  self->Wake();
+}
+
 void v8__Isolate__SetWasmStreamingCallback(v8::Isolate* isolate,
                                            v8::WasmStreamingCallback callback) {
   isolate->SetWasmStreamingCallback(callback);
@@ -777,6 +818,14 @@ bool v8__BackingStore__IsShared(const v8::BackingStore& self) {
 
 void v8__BackingStore__DELETE(v8::BackingStore* self) { delete self; }
 
+v8::BackingStore* v8__BackingStore__Reallocate(v8::Isolate* isolate,
+                                               v8::BackingStore* self,
+                                               size_t byte_length) {
+  std::unique_ptr<v8::BackingStore> u = v8::BackingStore::Reallocate(
+      isolate, std::unique_ptr<v8::BackingStore>(self), byte_length);
+  return u.release();
+}
+
 two_pointers_t std__shared_ptr__v8__BackingStore__COPY(
     const std::shared_ptr<v8::BackingStore>& ptr) {
   return make_pod<two_pointers_t>(ptr);
@@ -905,6 +954,35 @@ const v8::String* v8__String__NewExternalOneByteStatic(v8::Isolate* isolate,
       isolate, new ExternalStaticOneByteStringResource(data, length)));
 }
 
+using RustExternalOneByteFree = void (*)(char* data, size_t length);
+
+class ExternalOwnedOneByteStringResource
+    : public v8::String::ExternalOneByteStringResource {
+ public:
+  ExternalOwnedOneByteStringResource(char* data, size_t length,
+                                     RustExternalOneByteFree free)
+      : _data(data), _length(length), _free(free) {}
+  ~ExternalOwnedOneByteStringResource() override { _free(_data, _length); }
+  const char* data() const override { return _data; }
+  size_t length() const override { return _length; }
+
+ private:
+  char* const _data;
+  const size_t _length;
+  const RustExternalOneByteFree _free;
+};
+
+const v8::String* v8__String__NewExternalOneByte(v8::Isolate* isolate,
+                                                 char* data, size_t length,
+                                                 RustExternalOneByteFree free) {
+  auto resource = new ExternalOwnedOneByteStringResource(data, length, free);
+  if (length > static_cast<size_t>(v8::String::kMaxLength)) {
+    delete resource;
+    return nullptr;
+  }
+  return maybe_local_to_ptr(v8::String::NewExternalOneByte(isolate, resource));
+}
+
 class ExternalStaticStringResource : public v8::String::ExternalStringResource {
  public:
   ExternalStaticStringResource(const uint16_t* data, int length)
@@ -1087,6 +1165,57 @@ MaybeBool v8__Object__CreateDataProperty(const v8::Object& self,
       ptr_to_local(&context), ptr_to_local(&key), ptr_to_local(&value)));
 }
 
+MaybeBool v8__Object__CreateDataProperties(const v8::Object& self,
+                                           const v8::Context& context,
+                                           const v8::Name* const keys[],
+                                           const v8::Value* const values[],
+                                           size_t length) {
+  auto object = ptr_to_local(&self);
+  auto local_context = ptr_to_local(&context);
+  bool result = true;
+  for (size_t i = 0; i < length; i++) {
+    v8::Maybe<bool> maybe = object->CreateDataProperty(
+        local_context, ptr_to_local(keys[i]), ptr_to_local(values[i]));
+    if (maybe.IsNothing()) {
+      return MaybeBool::Nothing;
+    }
+    result = result && maybe.FromJust();
+  }
+  return result ? MaybeBool::JustTrue : MaybeBool::JustFalse;
+}
+
+bool v8__Object__GetProperties(const v8::Object& self,
+                               const v8::Context& context,
+                               const v8::Name* const keys[],
+                               const v8::Value* values[], size_t length) {
+  auto object = ptr_to_local(&self);
+  auto local_context = ptr_to_local(&context);
+  for (size_t i = 0; i < length; i++) {
+    v8::MaybeLocal<v8::Value> maybe =
+        object->Get(local_context, ptr_to_local(keys[i]));
+    if (maybe.IsEmpty()) {
+      return false;
+    }
+    values[i] = local_to_ptr(maybe.ToLocalChecked());
+  }
+  return true;
+}
+
+bool v8__Object__GetElements(const v8::Object& self,
+                             const v8::Context& context, uint32_t start,
+                             const v8::Value* values[], uint32_t length) {
+  auto object = ptr_to_local(&self);
+  auto local_context = ptr_to_local(&context);
+  for (uint32_t i = 0; i < length; i++) {
+    v8::MaybeLocal<v8::Value> maybe = object->Get(local_context, start + i);
+    if (maybe.IsEmpty()) {
+      return false;
+    }
+    values[i] = local_to_ptr(maybe.ToLocalChecked());
+  }
+  return true;
+}
+
 MaybeBool v8__Object__DefineOwnProperty(const v8::Object& self,
                                         const v8::Context& context,
                                         const v8::Name& key,
@@ -1313,6 +1442,23 @@ size_t v8__ArrayBufferView__CopyContents(const v8::ArrayBufferView& self,
   return ptr_to_local(&self)->CopyContents(dest, byte_length);
 }
 
+bool v8__ArrayBufferView__GetContents(const v8::ArrayBufferView& self,
+                                      void** data, size_t* byte_length) {
+  auto view = ptr_to_local(&self);
+  // Buffer() moves the contents of small, on-heap typed arrays to an
+  // off-heap backing store, so the data won't be moved by the GC afterwards.
+  auto buffer = view->Buffer();
+  if (buffer->IsSharedArrayBuffer()) {
+    return false;
+  }
+  // The reference count of the backing store is only touched here, on the
+  // C++ side; the ArrayBuffer keeps the store alive after it is released.
+  char* base = static_cast<char*>(buffer->GetBackingStore()->Data());
+  *byte_length = view->ByteLength();
+  *data = base == nullptr ? nullptr : base + view->ByteOffset();
+  return true;
+}
+
 struct RustAllocatorVtable {
   void* (*allocate)(void* handle, size_t length);
   void* (*allocate_uninitialized)(void* handle, size_t length);
@@ -1406,12 +1552,52 @@ void DeserializeInternalFields(v8::Local<v8::Object> holder, int index,
 
 const v8::Context* v8__Context__New(v8::Isolate* isolate,
                                     const v8::ObjectTemplate* templ,
-                                    const v8::Value* global_object) {
+                                    const v8::Value* global_object,
+                                    v8::MicrotaskQueue* microtask_queue) {
   return local_to_ptr(
       v8::Context::New(isolate, nullptr, ptr_to_maybe_local(templ),
                        ptr_to_maybe_local(global_object),
                        v8::DeserializeInternalFieldsCallback(
-                           DeserializeInternalFields, nullptr)));
+                           DeserializeInternalFields, nullptr),
+                       microtask_queue));
+}
+
+// Calls `finalizer(isolate, data)` after the context has been collected, or
+// never if the returned object is deleted first.
+struct ContextWeakFinalizer {
+  v8::Global<v8::Context> context;
+  void* data;
+  void (*finalizer)(v8::Isolate*, void*);
+};
+
+static void ContextWeakFinalizerSecondPass(
+    const v8::WeakCallbackInfo<ContextWeakFinalizer>& info) {
+  ContextWeakFinalizer* weak = info.GetParameter();
+  weak->finalizer(info.GetIsolate(), weak->data);
+  delete weak;
+}
+
+static void ContextWeakFinalizerFirstPass(
+    const v8::WeakCallbackInfo<ContextWeakFinalizer>& info) {
+  info.GetParameter()->context.Reset();
+  info.SetSecondPassCallback(ContextWeakFinalizerSecondPass);
+}
+
+ContextWeakFinalizer* v8__Context__SetWeakFinalizer(
+    const v8::Context& self, void* data,
+    void (*finalizer)(v8::Isolate*, void*)) {
+  auto context = ptr_to_local(&self);
+  auto weak = new ContextWeakFinalizer;
+  weak->context.Reset(context->GetIsolate(), context);
+  weak->data = data;
+  weak->finalizer = finalizer;
+  weak->context.SetWeak(weak, ContextWeakFinalizerFirstPass,
+                        v8::WeakCallbackType::kParameter);
+  return weak;
+}
+
+void v8__Context__WeakFinalizer__DELETE(ContextWeakFinalizer* self) {
+  delete self;
 }
 
 bool v8__Context__EQ(const v8::Context& self, const v8::Context& other) {
@@ -1432,6 +1618,28 @@ const v8::Object* v8__Context__Global(const v8::Context& self) {
   return local_to_ptr(ptr_to_local(&self)->Global());
 }
 
+const v8::Value* v8__Context__GetContinuationPreservedEmbedderData(
+    const v8::Context& self) {
+  return local_to_ptr(
+      ptr_to_local(&self)->GetContinuationPreservedEmbedderData());
+}
+
+void v8__Context__SetContinuationPreservedEmbedderData(
+    const v8::Context& self, const v8::Value& data) {
+  ptr_to_local(&self)->SetContinuationPreservedEmbedderData(
+      ptr_to_local(&data));
+}
+
+void v8__Context__SetPromiseHooks(const v8::Context& self,
+                                  const v8::Function* init_hook,
+                                  const v8::Function* before_hook,
+                                  const v8::Function* after_hook,
+                                  const v8::Function* resolve_hook) {
+  ptr_to_local(&self)->SetPromiseHooks(
+      ptr_to_local(init_hook), ptr_to_local(before_hook),
+      ptr_to_local(after_hook), ptr_to_local(resolve_hook));
+}
+
 const v8::Data* v8__Context__GetDataFromSnapshotOnce(v8::Context& self,
                                                      size_t index) {
   return maybe_local_to_ptr(
@@ -1889,6 +2097,28 @@ MaybeBool v8__Promise__Resolver__Reject(const v8::Promise::Resolver& self,
                                                          ptr_to_local(&value)));
 }
 
+size_t v8__Promise__Resolver__SettleAll(
+    const v8::Context& context, const v8::Promise::Resolver* const resolvers[],
+    const v8::Value* const values[], size_t length, bool reject) {
+  auto local_context = ptr_to_local(&context);
+  v8::Isolate* isolate = local_context->GetIsolate();
+  size_t settled = 0;
+  {
+    v8::HandleScope handle_scope(isolate);
+    for (; settled < length; settled++) {
+      auto resolver = ptr_to_local(resolvers[settled]);
+      auto value = ptr_to_local(values[settled]);
+      auto result = reject ? resolver->Reject(local_context, value)
+                           : resolver->Resolve(local_context, value);
+      if (result.IsNothing()) {
+        return settled;
+      }
+    }
+  }
+  isolate->PerformMicrotaskCheckpoint();
+  return settled;
+}
+
 v8::Promise::PromiseState v8__Promise__State(const v8::Promise& self) {
   return ptr_to_local(&self)->State();
 }
@@ -2422,11 +2652,46 @@ void v8__WasmStreaming__Abort(WasmStreamingSharedPtr* self,
   self->inner->Abort(ptr_to_maybe_local(exception));
 }
 
+v8::CompiledWasmModule* v8__WasmModuleObject__GetCompiledModule(
+    const v8::WasmModuleObject& self) {
+  return new v8::CompiledWasmModule(ptr_to_local(&self)->GetCompiledModule());
+}
+
+const v8::WasmModuleObject* v8__WasmModuleObject__FromCompiledModule(
+    v8::Isolate* isolate, const v8::CompiledWasmModule& compiled_module) {
+  return maybe_local_to_ptr(
+      v8::WasmModuleObject::FromCompiledModule(isolate, compiled_module));
+}
+
+const uint8_t* v8__CompiledWasmModule__GetWireBytesRef(
+    v8::CompiledWasmModule* self, size_t* length) {
+  v8::MemorySpan<const uint8_t> span = self->GetWireBytesRef();
+  *length = span.size();
+  return span.data();
+}
+
+void v8__CompiledWasmModule__DELETE(v8::CompiledWasmModule* self) {
+  delete self;
+}
+
 using HeapSnapshotCallback = bool (*)(void*, const char*, size_t);
+using HeapSnapshotProgressCallback = bool (*)(void*, int, int);
+
+void v8__HeapProfiler__TakeHeapSnapshot(
+    v8::Isolate* isolate, HeapSnapshotCallback callback,
+    HeapSnapshotProgressCallback progress_callback, void* arg) {
+  struct ActivityControl : public v8::ActivityControl {
+    ActivityControl(HeapSnapshotProgressCallback callback, void* arg)
+        : callback_(callback), arg_(arg) {}
+    v8::ActivityControl::ControlOption ReportProgressValue(int done,
+                                                           int total) override {
+      if (callback_(arg_, done, total)) return kContinue;
+      return kAbort;
+    }
+    HeapSnapshotProgressCallback const callback_;
+    void* const arg_;
+  };
 
-void v8__HeapProfiler__TakeHeapSnapshot(v8::Isolate* isolate,
-                                        HeapSnapshotCallback callback,
-                                        void* arg) {
   struct OutputStream : public v8::OutputStream {
     OutputStream(HeapSnapshotCallback callback, void* arg)
         : callback_(callback), arg_(arg) {}
@@ -2444,9 +2709,12 @@ void v8__HeapProfiler__TakeHeapSnapshot(v8::Isolate* isolate,
     void* const arg_;
   };
 
+  ActivityControl control(progress_callback, arg);
   const v8::HeapSnapshot* snapshot =
-      isolate->GetHeapProfiler()->TakeHeapSnapshot();
-  if (snapshot == nullptr) return;  // Snapshotting failed, probably OOM.
+      isolate->GetHeapProfiler()->TakeHeapSnapshot(
+          progress_callback != nullptr ? &control : nullptr);
+  // Snapshotting failed (probably OOM) or was aborted.
+  if (snapshot == nullptr) return;
   OutputStream stream(callback, arg);
   snapshot->Serialize(&stream);
   // We don't want to call HeapProfiler::DeleteAllHeapSnapshots() because that
@@ -2456,6 +2724,283 @@ void v8__HeapProfiler__TakeHeapSnapshot(v8::Isolate* isolate,
   const_cast<v8::HeapSnapshot*>(snapshot)->Delete();
 }
 
+bool v8__HeapProfiler__StartSamplingHeapProfiler(v8::Isolate* isolate,
+                                                 uint64_t sample_interval,
+                                                 int stack_depth,
+                                                 bool force_gc) {
+  return isolate->GetHeapProfiler()->StartSamplingHeapProfiler(
+      sample_interval, stack_depth,
+      force_gc ? v8::HeapProfiler::kSamplingForceGC
+               : v8::HeapProfiler::kSamplingNoFlags);
+}
+
+void v8__HeapProfiler__StopSamplingHeapProfiler(v8::Isolate* isolate) {
+  isolate->GetHeapProfiler()->StopSamplingHeapProfiler();
+}
+
+v8::AllocationProfile* v8__HeapProfiler__GetAllocationProfile(
+    v8::Isolate* isolate) {
+  return isolate->GetHeapProfiler()->GetAllocationProfile();
+}
+
+void v8__AllocationProfile__DELETE(v8::AllocationProfile* self) {
+  delete self;
+}
+
+v8::AllocationProfile::Node* v8__AllocationProfile__GetRootNode(
+    v8::AllocationProfile* self) {
+  return self->GetRootNode();
+}
+
+// Should match their counterparts in src/heap_profiler.rs.
+static_assert(sizeof(v8::AllocationProfile::Sample) == 4 * sizeof(uint64_t),
+              "AllocationProfile::Sample size mismatch");
+static_assert(sizeof(v8::AllocationProfile::Allocation) == 2 * sizeof(size_t),
+              "AllocationProfile::Allocation size mismatch");
+
+const v8::AllocationProfile::Sample* v8__AllocationProfile__GetSamples(
+    v8::AllocationProfile* self, size_t* length) {
+  const std::vector<v8::AllocationProfile::Sample>& samples =
+      self->GetSamples();
+  *length = samples.size();
+  return samples.data();
+}
+
+const v8::String* v8__AllocationProfile__Node__name(
+    const v8::AllocationProfile::Node& self) {
+  return local_to_ptr(self.name);
+}
+
+const v8::String* v8__AllocationProfile__Node__script_name(
+    const v8::AllocationProfile::Node& self) {
+  return local_to_ptr(self.script_name);
+}
+
+int v8__AllocationProfile__Node__script_id(
+    const v8::AllocationProfile::Node& self) {
+  return self.script_id;
+}
+
+int v8__AllocationProfile__Node__start_position(
+    const v8::AllocationProfile::Node& self) {
+  return self.start_position;
+}
+
+int v8__AllocationProfile__Node__line_number(
+    const v8::AllocationProfile::Node& self) {
+  return self.line_number;
+}
+
+int v8__AllocationProfile__Node__column_number(
+    const v8::AllocationProfile::Node& self) {
+  return self.column_number;
+}
+
+unsigned v8__AllocationProfile__Node__node_id(
+    const v8::AllocationProfile::Node& self) {
+  return self.node_id;
+}
+
+v8::AllocationProfile::Node* const* v8__AllocationProfile__Node__children(
+    const v8::AllocationProfile::Node& self, size_t* length) {
+  *length = self.children.size();
+  return self.children.data();
+}
+
+const v8::AllocationProfile::Allocation*
+v8__AllocationProfile__Node__allocations(
+    const v8::AllocationProfile::Node& self, size_t* length) {
+  *length = self.allocations.size();
+  return self.allocations.data();
+}
+
+void v8__Coverage__SelectMode(v8::Isolate* isolate,
+                              v8::debug::CoverageMode mode) {
+  v8::debug::Coverage::SelectMode(isolate, mode);
+}
+
+v8::debug::Coverage* v8__Coverage__CollectPrecise(v8::Isolate* isolate) {
+  // V8 only checks this in debug builds.
+  if (reinterpret_cast<v8::internal::Isolate*>(isolate)
+          ->is_best_effort_code_coverage()) {
+    return nullptr;
+  }
+  return new v8::debug::Coverage(v8::debug::Coverage::CollectPrecise(isolate));
+}
+
+v8::debug::Coverage* v8__Coverage__CollectBestEffort(v8::Isolate* isolate) {
+  return new v8::debug::Coverage(
+      v8::debug::Coverage::CollectBestEffort(isolate));
+}
+
+void v8__Coverage__DELETE(v8::debug::Coverage* self) { delete self; }
+
+size_t v8__Coverage__ScriptCount(const v8::debug::Coverage& self) {
+  return self.ScriptCount();
+}
+
+const v8::String* v8__Coverage__GetScript(const v8::debug::Coverage& self,
+                                          size_t script, int* script_id) {
+  v8::Local<v8::debug::Script> s = self.GetScriptData(script).GetScript();
+  *script_id = s->Id();
+  return maybe_local_to_ptr(s->Name());
+}
+
+size_t v8__Coverage__GetScriptLineEnds(const v8::debug::Coverage& self,
+                                       size_t script, int* line_ends,
+                                       size_t capacity) {
+  std::vector<int> ends = self.GetScriptData(script).GetScript()->LineEnds();
+  std::copy_n(ends.begin(), std::min(ends.size(), capacity), line_ends);
+  return ends.size();
+}
+
+size_t v8__Coverage__FunctionCount(const v8::debug::Coverage& self,
+                                   size_t script) {
+  return self.GetScriptData(script).FunctionCount();
+}
+
+// Should match its counterpart in src/coverage.rs.
+struct CoverageRange {
+  int start_offset;
+  int end_offset;
+  uint32_t count;
+};
+
+const v8::String* v8__Coverage__GetFunction(const v8::debug::Coverage& self,
+                                            size_t script, size_t function,
+                                            CoverageRange* range,
+                                            bool* has_block_coverage,
+                                            size_t* block_count) {
+  v8::debug::Coverage::FunctionData data =
+      self.GetScriptData(script).GetFunctionData(function);
+  *range = {data.StartOffset(), data.EndOffset(), data.Count()};
+  *has_block_coverage = data.HasBlockCoverage();
+  *block_count = data.BlockCount();
+  return maybe_local_to_ptr(data.Name());
+}
+
+void v8__Coverage__GetBlocks(const v8::debug::Coverage& self, size_t script,
+                             size_t function, CoverageRange* blocks) {
+  v8::debug::Coverage::FunctionData data =
+      self.GetScriptData(script).GetFunctionData(function);
+  for (size_t i = 0; i < data.BlockCount(); i++) {
+    v8::debug::Coverage::BlockData block = data.GetBlockData(i);
+    blocks[i] = {block.StartOffset(), block.EndOffset(), block.Count()};
+  }
+}
+
+v8::CpuProfiler* v8__CpuProfiler__New(
+    v8::Isolate* isolate, v8::CpuProfilingNamingMode naming_mode,
+    v8::CpuProfilingLoggingMode logging_mode) {
+  return v8::CpuProfiler::New(isolate, naming_mode, logging_mode);
+}
+
+void v8__CpuProfiler__Dispose(v8::CpuProfiler* self) { self->Dispose(); }
+
+void v8__CpuProfiler__SetSamplingInterval(v8::CpuProfiler* self, int us) {
+  self->SetSamplingInterval(us);
+}
+
+void v8__CpuProfiler__SetUsePreciseSampling(v8::CpuProfiler* self,
+                                            bool use_precise_sampling) {
+  self->SetUsePreciseSampling(use_precise_sampling);
+}
+
+v8::CpuProfilingStatus v8__CpuProfiler__StartProfiling(
+    v8::CpuProfiler* self, const v8::String& title, v8::CpuProfilingMode mode,
+    unsigned max_samples, int sampling_interval_us) {
+  return self->StartProfiling(
+      ptr_to_local(&title),
+      v8::CpuProfilingOptions(mode, max_samples, sampling_interval_us));
+}
+
+v8::CpuProfile* v8__CpuProfiler__StopProfiling(v8::CpuProfiler* self,
+                                               const v8::String& title) {
+  return self->StopProfiling(ptr_to_local(&title));
+}
+
+void v8__CpuProfile__Delete(v8::CpuProfile* self) { self->Delete(); }
+
+const v8::String* v8__CpuProfile__GetTitle(const v8::CpuProfile& self) {
+  return local_to_ptr(self.GetTitle());
+}
+
+const v8::CpuProfileNode* v8__CpuProfile__GetTopDownRoot(
+    const v8::CpuProfile& self) {
+  return self.GetTopDownRoot();
+}
+
+int v8__CpuProfile__GetSamplesCount(const v8::CpuProfile& self) {
+  return self.GetSamplesCount();
+}
+
+const v8::CpuProfileNode* v8__CpuProfile__GetSample(const v8::CpuProfile& self,
+                                                    int index) {
+  return self.GetSample(index);
+}
+
+int64_t v8__CpuProfile__GetSampleTimestamp(const v8::CpuProfile& self,
+                                           int index) {
+  return self.GetSampleTimestamp(index);
+}
+
+int64_t v8__CpuProfile__GetStartTime(const v8::CpuProfile& self) {
+  return self.GetStartTime();
+}
+
+int64_t v8__CpuProfile__GetEndTime(const v8::CpuProfile& self) {
+  return self.GetEndTime();
+}
+
+const char* v8__CpuProfileNode__GetFunctionNameStr(
+    const v8::CpuProfileNode& self) {
+  return self.GetFunctionNameStr();
+}
+
+int v8__CpuProfileNode__GetScriptId(const v8::CpuProfileNode& self) {
+  return self.GetScriptId();
+}
+
+const char* v8__CpuProfileNode__GetScriptResourceNameStr(
+    const v8::CpuProfileNode& self) {
+  return self.GetScriptResourceNameStr();
+}
+
+int v8__CpuProfileNode__GetLineNumber(const v8::CpuProfileNode& self) {
+  return self.GetLineNumber();
+}
+
+int v8__CpuProfileNode__GetColumnNumber(const v8::CpuProfileNode& self) {
+  return self.GetColumnNumber();
+}
+
+const char* v8__CpuProfileNode__GetBailoutReason(
+    const v8::CpuProfileNode& self) {
+  return self.GetBailoutReason();
+}
+
+unsigned v8__CpuProfileNode__GetHitCount(const v8::CpuProfileNode& self) {
+  return self.GetHitCount();
+}
+
+unsigned v8__CpuProfileNode__GetNodeId(const v8::CpuProfileNode& self) {
+  return self.GetNodeId();
+}
+
+const v8::CpuProfileNode* v8__CpuProfileNode__GetParent(
+    const v8::CpuProfileNode& self) {
+  return self.GetParent();
+}
+
+int v8__CpuProfileNode__GetChildrenCount(const v8::CpuProfileNode& self) {
+  return self.GetChildrenCount();
+}
+
+const v8::CpuProfileNode* v8__CpuProfileNode__GetChild(
+    const v8::CpuProfileNode& self, int index) {
+  return self.GetChild(index);
+}
+
 // This is necessary for v8__internal__GetIsolateFromHeapObject() to be
 // reliable enough for our purposes.
 #if !(defined V8_SHARED_RO_HEAP or defined V8_COMPRESS_POINTERS)
@@ -2619,6 +3164,11 @@ void v8__ValueSerializer__WriteHeader(v8::ValueSerializer* self) {
   self->WriteHeader();
 }
 
+void v8__ValueSerializer__SetTreatArrayBufferViewsAsHostObjects(
+    v8::ValueSerializer* self, bool mode) {
+  self->SetTreatArrayBufferViewsAsHostObjects(mode);
+}
+
 MaybeBool v8__ValueSerializer__WriteValue(v8::ValueSerializer* self,
                                           v8::Local<v8::Context> context,
                                           v8::Local<v8::Value> value) {
@@ -1,20 +1,84 @@
 // Copyright 2019-2021 the Deno authors. All rights reserved. MIT license.
 use crate::isolate::Isolate;
+use crate::support::Opaque;
+use crate::support::UniqueRef;
 use crate::Context;
+#[cfg(feature = "promise_hooks")]
+use crate::Function;
 use crate::HandleScope;
 use crate::Local;
+use crate::MicrotaskQueue;
 use crate::Object;
 use crate::ObjectTemplate;
 use crate::Value;
+use std::collections::HashMap;
+use std::ffi::c_void;
 use std::ptr::null;
+use std::rc::Rc;
 
 extern "C" {
   fn v8__Context__New(
     isolate: *mut Isolate,
     templ: *const ObjectTemplate,
     global_object: *const Value,
+    microtask_queue: *const MicrotaskQueue,
   ) -> *const Context;
   fn v8__Context__Global(this: *const Context) -> *const Object;
+  fn v8__Context__GetContinuationPreservedEmbedderData(
+    this: *const Context,
+  ) -> *const Value;
+  fn v8__Context__SetContinuationPreservedEmbedderData(
+    this: *const Context,
+    data: *const Value,
+  );
+  #[cfg(feature = "promise_hooks")]
+  fn v8__Context__SetPromiseHooks(
+    this: *const Context,
+    init_hook: *const Function,
+    before_hook: *const Function,
+    after_hook: *const Function,
+    resolve_hook: *const Function,
+  );
+  fn v8__Context__SetWeakFinalizer(
+    this: *const Context,
+    data: *mut c_void,
+    finalizer: extern "C" fn(*mut Isolate, *mut c_void),
+  ) -> *mut WeakFinalizer;
+  fn v8__Context__WeakFinalizer__DELETE(this: *mut WeakFinalizer);
+}
+
+#[repr(C)]
+struct WeakFinalizer(Opaque);
+
+/// The microtask queues of the live contexts created with
+/// `Context::new_with_microtask_queue()`, kept in an isolate slot and keyed by
+/// context. An entry is removed by a weak callback once its context has been
+/// collected. The type is private to this module, so the slot can't be
+/// replaced from outside.
+#[derive(Default)]
+struct ContextMicrotaskQueues {
+  next_id: usize,
+  queues: HashMap<usize, (Rc<UniqueRef<MicrotaskQueue>>, *mut WeakFinalizer)>,
+}
+
+impl Drop for ContextMicrotaskQueues {
+  fn drop(&mut self) {
+    // The isolate is being disposed: cancel the callbacks of the contexts
+    // that are still alive.
+    for (_, (_, finalizer)) in self.queues.drain() {
+      unsafe { v8__Context__WeakFinalizer__DELETE(finalizer) }
+    }
+  }
+}
+
+extern "C" fn release_microtask_queue(isolate: *mut Isolate, id: *mut c_void) {
+  let isolate = unsafe { &mut *isolate };
+  // The finalizer deletes itself after this call returns.
+  let entry = isolate
+    .get_slot_mut::<ContextMicrotaskQueues>()
+    .and_then(|queues| queues.queues.remove(&(id as usize)));
+  // Drop the queue outside of the slot borrow.
+  drop(entry);
 }
 
 impl Context {
@@ -22,12 +86,51 @@ impl Context {
   pub fn new<'s>(scope: &mut HandleScope<'s, ()>) -> Local<'s, Context> {
     // TODO: optional arguments;
     unsafe {
-      scope
-        .cast_local(|sd| v8__Context__New(sd.get_isolate_ptr(), null(), null()))
+      scope.cast_local(|sd| {
+        v8__Context__New(sd.get_isolate_ptr(), null(), null(), null())
+      })
     }
     .unwrap()
   }
 
+  /// Creates a new context whose microtasks (e.g. promise reactions) are
+  /// queued on `microtask_queue` rather than on the isolate's default queue.
+  ///
+  /// The context keeps a reference to `microtask_queue` until it is garbage
+  /// collected (or the isolate is disposed), so the queue is deleted once
+  /// neither the embedder nor any of its contexts use it.
+  pub fn new_with_microtask_queue<'s>(
+    scope: &mut HandleScope<'s, ()>,
+    microtask_queue: Rc<UniqueRef<MicrotaskQueue>>,
+  ) -> Local<'s, Context> {
+    let context = unsafe {
+      scope.cast_local(|sd| {
+        v8__Context__New(
+          sd.get_isolate_ptr(),
+          null(),
+          null(),
+          &**microtask_queue,
+        )
+      })
+    }
+    .unwrap();
+    if scope.get_slot::<ContextMicrotaskQueues>().is_none() {
+      scope.set_slot(ContextMicrotaskQueues::default());
+    }
+    let queues = scope.get_slot_mut::<ContextMicrotaskQueues>().unwrap();
+    let id = queues.next_id;
+    queues.next_id += 1;
+    let finalizer = unsafe {
+      v8__Context__SetWeakFinalizer(
+        &*context,
+        id as *mut c_void,
+        release_microtask_queue,
+      )
+    };
+    queues.queues.insert(id, (microtask_queue, finalizer));
+    context
+  }
+
   /// Creates a new context using the object template as the template for
   /// the global object.
   pub fn new_from_template<'s>(
@@ -36,7 +139,7 @@ impl Context {
   ) -> Local<'s, Context> {
     unsafe {
       scope.cast_local(|sd| {
-        v8__Context__New(sd.get_isolate_ptr(), &*templ, null())
+        v8__Context__New(sd.get_isolate_ptr(), &*templ, null(), null())
       })
     }
     .unwrap()
@@ -58,4 +161,65 @@ impl Context {
   ) -> Local<'s, Object> {
     unsafe { scope.cast_local(|_| v8__Context__Global(self)) }.unwrap()
   }
+
+  /// Returns the value last set with
+  /// `set_continuation_preserved_embedder_data()`, or undefined.
+  pub fn get_continuation_preserved_embedder_data<'s>(
+    &self,
+    scope: &mut HandleScope<'s, ()>,
+  ) -> Local<'s, Value> {
+    unsafe {
+      scope
+        .cast_local(|_| v8__Context__GetContinuationPreservedEmbedderData(self))
+    }
+    .unwrap()
+  }
+
+  /// Sets a value that is captured by promise reactions (`then()` callbacks
+  /// and `await` continuations) when they are created, and is restored
+  /// while they run. This lets embedder data follow the logical flow of
+  /// async code without a promise hook; see `AsyncContextVariable`.
+  pub fn set_continuation_preserved_embedder_data(&self, data: Local<Value>) {
+    unsafe { v8__Context__SetContinuationPreservedEmbedderData(self, &*data) }
+  }
+
+  /// Sets JavaScript functions to be called on the promise lifecycle events
+  /// of this context, replacing any hooks that were set before. Unlike the
+  /// native hook installed with `Isolate::set_promise_hook()`, each event
+  /// type has its own hook and an event whose hook is None costs nothing.
+  /// The hooks are called from generated code without leaving JavaScript,
+  /// so V8 can inline them.
+  ///
+  /// - `init_hook(promise, parent)` is called when a promise is created;
+  ///   `parent` is the promise it was chained from, or undefined.
+  /// - `before_hook(promise)` and `after_hook(promise)` are called around
+  ///   the execution of a reaction of `promise`.
+  /// - `resolve_hook(promise)` is called when a promise is resolved or
+  ///   rejected.
+  ///
+  /// Requires the `promise_hooks` feature and a V8 built with
+  /// `v8_enable_javascript_promise_hooks = true`; otherwise V8 fails a check
+  /// when this is called. The prebuilt static libraries don't enable it, so
+  /// build V8 from source (`V8_FROM_SOURCE=1`) to use it.
+  #[cfg(feature = "promise_hooks")]
+  pub fn set_promise_hooks(
+    &self,
+    init_hook: Option<Local<Function>>,
+    before_hook: Option<Local<Function>>,
+    after_hook: Option<Local<Function>>,
+    resolve_hook: Option<Local<Function>>,
+  ) {
+    let hook_ptr = |hook: Option<Local<Function>>| {
+      hook.map_or_else(null, |h| &*h as *const _)
+    };
+    unsafe {
+      v8__Context__SetPromiseHooks(
+        self,
+        hook_ptr(init_hook),
+        hook_ptr(before_hook),
+        hook_ptr(after_hook),
+        hook_ptr(resolve_hook),
+      )
+    }
+  }
 }
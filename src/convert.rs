@@ -0,0 +1,506 @@
+// Copyright 2019-2021 the Deno authors. All rights reserved. MIT license.
+//! Conversion between Rust values and V8 values.
+//!
+//! The `ToV8` and `FromV8` traits are implemented for the Rust primitives,
+//! `String`, `Option`, `Vec` and `HashMap<String, _>`. The `v8_struct!` and
+//! `v8_enum!` macros implement them for structs with named fields and for
+//! enums with unit variants:
+//!
+//! ```ignore
+//! rusty_v8::v8_struct! {
+//!   #[derive(Debug, PartialEq)]
+//!   pub struct Point {
+//!     pub x: f64,
+//!     pub y: f64,
+//!   }
+//! }
+//!
+//! let value = Point { x: 1.0, y: 2.0 }.to_v8(scope).unwrap();
+//! let point = Point::from_v8(scope, value).unwrap();
+//! ```
+//!
+//! Structs are converted to plain objects and back with a single call into
+//! V8 for all fields (see `Object::create_data_properties()` and
+//! `Object::get_properties()`). The property names are created once per
+//! isolate as internalized strings and kept in an isolate slot, so repeated
+//! conversions don't allocate or hash the field names again.
+use crate::Array;
+use crate::Boolean;
+use crate::Global;
+use crate::HandleScope;
+use crate::Integer;
+use crate::Local;
+use crate::Name;
+use crate::NewStringType;
+use crate::Number;
+use crate::Object;
+use crate::String;
+use crate::Value;
+
+use std::collections::HashMap;
+use std::convert::TryFrom;
+use std::hash::BuildHasher;
+use std::marker::PhantomData;
+use std::ptr::NonNull;
+
+/// A Rust value that can be converted to a V8 value.
+pub trait ToV8 {
+  /// Returns None if the value could not be created, e.g. because a string
+  /// exceeds `String::max_length()` or a getter threw an exception.
+  fn to_v8<'s>(&self, scope: &mut HandleScope<'s>) -> Option<Local<'s, Value>>;
+}
+
+/// A Rust value that can be created from a V8 value.
+pub trait FromV8: Sized {
+  /// Returns None if `value` does not have the expected type. Numbers are
+  /// not coerced, so e.g. a string is never converted to an `f64`.
+  fn from_v8<'s>(
+    scope: &mut HandleScope<'s>,
+    value: Local<'s, Value>,
+  ) -> Option<Self>;
+}
+
+impl<T: ToV8 + ?Sized> ToV8 for &T {
+  fn to_v8<'s>(&self, scope: &mut HandleScope<'s>) -> Option<Local<'s, Value>> {
+    (**self).to_v8(scope)
+  }
+}
+
+impl<T: ToV8 + ?Sized> ToV8 for Box<T> {
+  fn to_v8<'s>(&self, scope: &mut HandleScope<'s>) -> Option<Local<'s, Value>> {
+    (**self).to_v8(scope)
+  }
+}
+
+impl<T: FromV8> FromV8 for Box<T> {
+  fn from_v8<'s>(
+    scope: &mut HandleScope<'s>,
+    value: Local<'s, Value>,
+  ) -> Option<Self> {
+    T::from_v8(scope, value).map(Box::new)
+  }
+}
+
+impl ToV8 for bool {
+  fn to_v8<'s>(&self, scope: &mut HandleScope<'s>) -> Option<Local<'s, Value>> {
+    Some(Boolean::new(scope, *self).into())
+  }
+}
+
+impl FromV8 for bool {
+  fn from_v8<'s>(
+    _scope: &mut HandleScope<'s>,
+    value: Local<'s, Value>,
+  ) -> Option<Self> {
+    if value.is_boolean() {
+      Some(value.is_true())
+    } else {
+      None
+    }
+  }
+}
+
+impl ToV8 for i32 {
+  fn to_v8<'s>(&self, scope: &mut HandleScope<'s>) -> Option<Local<'s, Value>> {
+    Some(Integer::new(scope, *self).into())
+  }
+}
+
+impl FromV8 for i32 {
+  fn from_v8<'s>(
+    _scope: &mut HandleScope<'s>,
+    value: Local<'s, Value>,
+  ) -> Option<Self> {
+    if value.is_int32() {
+      let integer = Local::<Integer>::try_from(value).ok()?;
+      Some(integer.value() as i32)
+    } else {
+      None
+    }
+  }
+}
+
+impl ToV8 for u32 {
+  fn to_v8<'s>(&self, scope: &mut HandleScope<'s>) -> Option<Local<'s, Value>> {
+    Some(Integer::new_from_unsigned(scope, *self).into())
+  }
+}
+
+impl FromV8 for u32 {
+  fn from_v8<'s>(
+    _scope: &mut HandleScope<'s>,
+    value: Local<'s, Value>,
+  ) -> Option<Self> {
+    if value.is_uint32() {
+      let integer = Local::<Integer>::try_from(value).ok()?;
+      Some(integer.value() as u32)
+    } else {
+      None
+    }
+  }
+}
+
+impl ToV8 for f64 {
+  fn to_v8<'s>(&self, scope: &mut HandleScope<'s>) -> Option<Local<'s, Value>> {
+    Some(Number::new(scope, *self).into())
+  }
+}
+
+impl FromV8 for f64 {
+  fn from_v8<'s>(
+    _scope: &mut HandleScope<'s>,
+    value: Local<'s, Value>,
+  ) -> Option<Self> {
+    let number = Local::<Number>::try_from(value).ok()?;
+    Some(number.value())
+  }
+}
+
+impl ToV8 for str {
+  fn to_v8<'s>(&self, scope: &mut HandleScope<'s>) -> Option<Local<'s, Value>> {
+    String::new(scope, self).map(Into::into)
+  }
+}
+
+impl ToV8 for std::string::String {
+  fn to_v8<'s>(&self, scope: &mut HandleScope<'s>) -> Option<Local<'s, Value>> {
+    self.as_str().to_v8(scope)
+  }
+}
+
+impl FromV8 for std::string::String {
+  fn from_v8<'s>(
+    scope: &mut HandleScope<'s>,
+    value: Local<'s, Value>,
+  ) -> Option<Self> {
+    let string = Local::<String>::try_from(value).ok()?;
+    Some(string.to_rust_string_lossy(scope))
+  }
+}
+
+/// `None` is converted to `null`. Both `null` and `undefined` are converted
+/// to `None`.
+impl<T: ToV8> ToV8 for Option<T> {
+  fn to_v8<'s>(&self, scope: &mut HandleScope<'s>) -> Option<Local<'s, Value>> {
+    match self {
+      Some(value) => value.to_v8(scope),
+      None => Some(crate::null(scope).into()),
+    }
+  }
+}
+
+impl<T: FromV8> FromV8 for Option<T> {
+  fn from_v8<'s>(
+    scope: &mut HandleScope<'s>,
+    value: Local<'s, Value>,
+  ) -> Option<Self> {
+    if value.is_null_or_undefined() {
+      Some(None)
+    } else {
+      T::from_v8(scope, value).map(Some)
+    }
+  }
+}
+
+/// Slices are converted to arrays, which are created with all their elements
+/// at once.
+impl<T: ToV8> ToV8 for [T] {
+  fn to_v8<'s>(&self, scope: &mut HandleScope<'s>) -> Option<Local<'s, Value>> {
+    let elements = self
+      .iter()
+      .map(|element| element.to_v8(scope))
+      .collect::<Option<Vec<_>>>()?;
+    Some(Array::new_with_elements(scope, &elements).into())
+  }
+}
+
+impl<T: ToV8> ToV8 for Vec<T> {
+  fn to_v8<'s>(&self, scope: &mut HandleScope<'s>) -> Option<Local<'s, Value>> {
+    self.as_slice().to_v8(scope)
+  }
+}
+
+impl<T: FromV8> FromV8 for Vec<T> {
+  fn from_v8<'s>(
+    scope: &mut HandleScope<'s>,
+    value: Local<'s, Value>,
+  ) -> Option<Self> {
+    let array = Local::<Array>::try_from(value).ok()?;
+    let length = array.length();
+    let mut elements = Vec::with_capacity(length.min(CHUNK_LEN) as usize);
+    for_each_chunk(scope, array.into(), length, |scope, chunk| {
+      for element in chunk {
+        elements.push(T::from_v8(scope, (*element)?)?);
+      }
+      Some(())
+    })?;
+    Some(elements)
+  }
+}
+
+/// Maps are converted to plain objects, not to JavaScript `Map`s.
+impl<T: ToV8, S> ToV8 for HashMap<std::string::String, T, S> {
+  fn to_v8<'s>(&self, scope: &mut HandleScope<'s>) -> Option<Local<'s, Value>> {
+    let mut keys = Vec::with_capacity(self.len());
+    let mut values = Vec::with_capacity(self.len());
+    for (key, value) in self {
+      let key = String::new(scope, key)?;
+      keys.push(key.into());
+      values.push(value.to_v8(scope)?);
+    }
+    let object = Object::new(scope);
+    object.create_data_properties(scope, &keys, &values)?;
+    Some(object.into())
+  }
+}
+
+impl<T: FromV8, S: BuildHasher + Default> FromV8
+  for HashMap<std::string::String, T, S>
+{
+  fn from_v8<'s>(
+    scope: &mut HandleScope<'s>,
+    value: Local<'s, Value>,
+  ) -> Option<Self> {
+    let object = Local::<Object>::try_from(value).ok()?;
+    let names = object.get_own_property_names(scope)?;
+    let length = names.length();
+    let mut map = HashMap::with_capacity_and_hasher(
+      length.min(CHUNK_LEN) as usize,
+      S::default(),
+    );
+    for_each_chunk(scope, names.into(), length, |scope, chunk| {
+      let mut keys = Vec::with_capacity(chunk.len());
+      for key in chunk {
+        let key = (*key)?;
+        // Integer keys are returned as numbers.
+        keys.push(match Local::<Name>::try_from(key) {
+          Ok(name) => name,
+          Err(_) => key.to_string(scope)?.into(),
+        });
+      }
+      let mut values = [None; CHUNK_LEN as usize];
+      let values = &mut values[..keys.len()];
+      object.get_properties(scope, &keys, values)?;
+      for (key, value) in keys.iter().zip(values.iter()) {
+        let key = key.to_rust_string_lossy(scope);
+        map.insert(key, T::from_v8(scope, (*value)?)?);
+      }
+      Some(())
+    })?;
+    Some(map)
+  }
+}
+
+/// The number of elements that are read from V8 at once. Arrays are read in
+/// chunks of this size, each in its own `HandleScope`, so that memory is only
+/// used for the elements that are actually converted: the `length` of a
+/// sparse array can be up to 2^32 - 1 without the array using any memory.
+const CHUNK_LEN: u32 = 1024;
+
+/// Calls `f` with the elements at the indices `0..length` of `object`, in
+/// chunks of up to `CHUNK_LEN`. Stops and returns None as soon as a getter
+/// throws or `f` returns None.
+fn for_each_chunk<'s>(
+  scope: &mut HandleScope<'s>,
+  object: Local<'s, Object>,
+  length: u32,
+  mut f: impl for<'c> FnMut(
+    &mut HandleScope<'c>,
+    &[Option<Local<'c, Value>>],
+  ) -> Option<()>,
+) -> Option<()> {
+  let mut start = 0;
+  while start < length {
+    let scope = &mut HandleScope::new(scope);
+    let mut chunk = [None; CHUNK_LEN as usize];
+    let chunk = &mut chunk[..(length - start).min(CHUNK_LEN) as usize];
+    object.get_elements(scope, start, chunk)?;
+    f(scope, chunk)?;
+    start += chunk.len() as u32;
+  }
+  Some(())
+}
+
+/// Property names of the struct or enum `T`, kept alive in an isolate slot.
+struct KeyCache<T> {
+  _keys: Vec<Global<Name>>,
+  raw_keys: Box<[NonNull<Name>]>,
+  _phantom: PhantomData<T>,
+}
+
+/// Returns the internalized strings for `names`. They are created the first
+/// time this function is called for `T` in an isolate, and reused after
+/// that. Used by `v8_struct!` and `v8_enum!`.
+#[doc(hidden)]
+pub fn cached_keys<'s, T: 'static>(
+  scope: &mut HandleScope<'s>,
+  names: &'static [&'static str],
+) -> &'s [Local<'s, Name>] {
+  if scope.get_slot::<KeyCache<T>>().is_none() {
+    let keys = names
+      .iter()
+      .map(|name| {
+        let key = String::new_from_utf8(
+          scope,
+          name.as_bytes(),
+          NewStringType::Internalized,
+        )
+        .unwrap();
+        Global::<Name>::new(scope, Local::<Name>::from(key))
+      })
+      .collect::<Vec<_>>();
+    let raw_keys = keys
+      .iter()
+      .map(|key| NonNull::from(key.get(scope)))
+      .collect();
+    scope.set_slot(KeyCache::<T> {
+      _keys: keys,
+      raw_keys,
+      _phantom: PhantomData,
+    });
+  }
+  let cache = scope.get_slot::<KeyCache<T>>().unwrap();
+  debug_assert_eq!(cache.raw_keys.len(), names.len());
+  // A `Local` is a pointer to a handle slot, just like the pointers held by
+  // the cache, which point to the slots of its global handles. Those stay
+  // valid until the isolate is disposed: `KeyCache` is private to this
+  // module, so the slot can't be replaced or removed from outside.
+  unsafe {
+    &*(&*cache.raw_keys as *const [NonNull<Name>] as *const [Local<'s, Name>])
+  }
+}
+
+/// Defines a struct with named fields and implements `ToV8` and `FromV8`
+/// for it. The struct is converted to a plain object that has a property
+/// for every field, named like the field. Every field type must implement
+/// `ToV8` and `FromV8`. Generic structs are not supported.
+#[macro_export]
+macro_rules! v8_struct {
+  (
+    $(#[$meta:meta])*
+    $vis:vis struct $name:ident {
+      $(
+        $(#[$field_meta:meta])*
+        $field_vis:vis $field:ident : $type:ty
+      ),* $(,)?
+    }
+  ) => {
+    $(#[$meta])*
+    $vis struct $name {
+      $(
+        $(#[$field_meta])*
+        $field_vis $field: $type
+      ),*
+    }
+
+    impl $crate::convert::ToV8 for $name {
+      fn to_v8<'s>(
+        &self,
+        scope: &mut $crate::HandleScope<'s>,
+      ) -> ::std::option::Option<$crate::Local<'s, $crate::Value>> {
+        let keys = $crate::convert::cached_keys::<Self>(
+          scope,
+          &[$(stringify!($field)),*],
+        );
+        let values: &[$crate::Local<$crate::Value>] = &[
+          $($crate::convert::ToV8::to_v8(&self.$field, scope)?),*
+        ];
+        let object = $crate::Object::new(scope);
+        object.create_data_properties(scope, keys, values)?;
+        ::std::option::Option::Some(object.into())
+      }
+    }
+
+    impl $crate::convert::FromV8 for $name {
+      #[allow(unused_variables)]
+      fn from_v8<'s>(
+        scope: &mut $crate::HandleScope<'s>,
+        value: $crate::Local<'s, $crate::Value>,
+      ) -> ::std::option::Option<Self> {
+        use ::std::convert::TryFrom;
+        let object = $crate::Local::<$crate::Object>::try_from(value).ok()?;
+        let keys = $crate::convert::cached_keys::<Self>(
+          scope,
+          &[$(stringify!($field)),*],
+        );
+        let mut values = [
+          $({
+            let _ = stringify!($field);
+            ::std::option::Option::None
+          }),*
+        ];
+        object.get_properties(scope, keys, &mut values)?;
+        let [$($field),*] = values;
+        ::std::option::Option::Some(Self {
+          $($field: $crate::convert::FromV8::from_v8(scope, $field?)?),*
+        })
+      }
+    }
+  };
+}
+
+/// Defines an enum with unit variants and implements `ToV8` and `FromV8` for
+/// it. Every variant is converted to a string with the name of the variant.
+/// The strings are cached like the property names of `v8_struct!`, so
+/// neither direction allocates: a string is converted back by comparing it
+/// with the cached strings, which V8 does by identity for internalized
+/// strings such as literals.
+#[macro_export]
+macro_rules! v8_enum {
+  (
+    $(#[$meta:meta])*
+    $vis:vis enum $name:ident {
+      $(
+        $(#[$variant_meta:meta])*
+        $variant:ident
+      ),* $(,)?
+    }
+  ) => {
+    $(#[$meta])*
+    $vis enum $name {
+      $(
+        $(#[$variant_meta])*
+        $variant
+      ),*
+    }
+
+    impl $crate::convert::ToV8 for $name {
+      fn to_v8<'s>(
+        &self,
+        scope: &mut $crate::HandleScope<'s>,
+      ) -> ::std::option::Option<$crate::Local<'s, $crate::Value>> {
+        // The variants can't have explicit discriminants, so those are the
+        // indices of their names.
+        let index = match self {
+          $($name::$variant => $name::$variant as usize),*
+        };
+        let keys = $crate::convert::cached_keys::<Self>(
+          scope,
+          &[$(stringify!($variant)),*],
+        );
+        ::std::option::Option::Some(keys[index].into())
+      }
+    }
+
+    impl $crate::convert::FromV8 for $name {
+      fn from_v8<'s>(
+        scope: &mut $crate::HandleScope<'s>,
+        value: $crate::Local<'s, $crate::Value>,
+      ) -> ::std::option::Option<Self> {
+        if !value.is_string() {
+          return ::std::option::Option::None;
+        }
+        let keys = $crate::convert::cached_keys::<Self>(
+          scope,
+          &[$(stringify!($variant)),*],
+        );
+        $(
+          if value.strict_equals(keys[$name::$variant as usize].into()) {
+            return ::std::option::Option::Some($name::$variant);
+          }
+        )*
+        ::std::option::Option::None
+      }
+    }
+  };
+}
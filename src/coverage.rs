@@ -0,0 +1,368 @@
+// Copyright 2019-2021 the Deno authors. All rights reserved. MIT license.
+
+use std::cmp::Reverse;
+use std::io;
+use std::io::Write;
+use std::ptr::null_mut;
+
+use crate::support::int;
+use crate::support::Opaque;
+use crate::HandleScope;
+use crate::String;
+
+extern "C" {
+  fn v8__Coverage__DELETE(this: *mut RawCoverage);
+  fn v8__Coverage__ScriptCount(this: *const RawCoverage) -> usize;
+  fn v8__Coverage__GetScript(
+    this: *const RawCoverage,
+    script: usize,
+    script_id: *mut int,
+  ) -> *const String;
+  fn v8__Coverage__GetScriptLineEnds(
+    this: *const RawCoverage,
+    script: usize,
+    line_ends: *mut int,
+    capacity: usize,
+  ) -> usize;
+  fn v8__Coverage__FunctionCount(
+    this: *const RawCoverage,
+    script: usize,
+  ) -> usize;
+  fn v8__Coverage__GetFunction(
+    this: *const RawCoverage,
+    script: usize,
+    function: usize,
+    range: *mut CoverageRange,
+    has_block_coverage: *mut bool,
+    block_count: *mut usize,
+  ) -> *const String;
+  fn v8__Coverage__GetBlocks(
+    this: *const RawCoverage,
+    script: usize,
+    function: usize,
+    blocks: *mut CoverageRange,
+  );
+}
+
+#[repr(C)]
+pub(crate) struct RawCoverage(Opaque);
+
+/// How precisely V8 collects code coverage. See
+/// `Isolate::select_coverage_mode()`.
+#[repr(C)]
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum CoverageMode {
+  /// The default: invocation counts are only available for functions whose
+  /// feedback vectors haven't been collected, so they're often missing, and
+  /// they're never reset.
+  BestEffort,
+  /// Invocation counts for every function, reset when they are collected.
+  PreciseCount,
+  /// Whether every function was invoked since the last collection.
+  PreciseBinary,
+  /// Like `PreciseCount`, but also counts how often each block of code
+  /// inside a function was executed.
+  BlockCount,
+  /// Like `PreciseBinary`, but for blocks too.
+  BlockBinary,
+}
+
+/// Code coverage for every script that is still alive. Collected with
+/// `Isolate::take_precise_coverage()` or
+/// `Isolate::take_best_effort_coverage()`.
+#[derive(Debug, Clone)]
+pub struct Coverage {
+  pub scripts: Vec<ScriptCoverage>,
+}
+
+#[derive(Debug, Clone)]
+pub struct ScriptCoverage {
+  pub script_id: i32,
+  /// The script's resource name, or an empty string if it has none.
+  pub url: std::string::String,
+  /// The offsets of the line terminators in the script's source. The last
+  /// entry is the length of the source if it doesn't end with a newline.
+  pub line_ends: Vec<i32>,
+  /// The functions in the script, sorted by their start offset. The first
+  /// one is the script's top-level code.
+  pub functions: Vec<FunctionCoverage>,
+}
+
+#[derive(Debug, Clone)]
+pub struct FunctionCoverage {
+  /// The name of the function, or an empty string for anonymous functions
+  /// and the top-level code.
+  pub name: std::string::String,
+  /// The function's source range and invocation count.
+  pub range: CoverageRange,
+  /// Whether `blocks` was collected, in one of the block coverage modes.
+  pub has_block_coverage: bool,
+  /// Nested ranges of the function's source whose execution count differs
+  /// from that of the enclosing range.
+  pub blocks: Vec<CoverageRange>,
+}
+
+/// A range of source code and how often it was executed.
+#[repr(C)]
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct CoverageRange {
+  pub start_offset: i32,
+  /// The offset just after the range.
+  pub end_offset: i32,
+  pub count: u32,
+}
+
+impl Coverage {
+  /// Copies the coverage out of V8's representation and deletes it.
+  pub(crate) unsafe fn from_raw(
+    scope: &mut HandleScope<()>,
+    raw: *mut RawCoverage,
+  ) -> Self {
+    let scripts = (0..v8__Coverage__ScriptCount(raw))
+      .map(|script| ScriptCoverage::from_raw(scope, raw, script))
+      .collect();
+    v8__Coverage__DELETE(raw);
+    Self { scripts }
+  }
+
+  /// Writes the coverage in the LCOV tracefile format read by `genhtml` and
+  /// most coverage services, with function and line records for each
+  /// script. Scripts without a resource name are skipped.
+  ///
+  /// A line's execution count is that of the innermost range, function or
+  /// block, that contains the whole line; lines that no range contains
+  /// entirely are left out. Blocks are not reported as branches, since V8
+  /// doesn't tell which blocks are alternatives of the same branch.
+  pub fn write_lcov(&self, mut writer: impl Write) -> io::Result<()> {
+    for script in &self.scripts {
+      if !script.url.is_empty() {
+        write_lcov_script(&mut writer, script)?;
+      }
+    }
+    writer.flush()
+  }
+}
+
+impl ScriptCoverage {
+  unsafe fn from_raw(
+    scope: &mut HandleScope<()>,
+    raw: *const RawCoverage,
+    script: usize,
+  ) -> Self {
+    let mut script_id = 0;
+    let url = v8__Coverage__GetScript(raw, script, &mut script_id);
+    let url = url
+      .as_ref()
+      .map(|url| url.to_rust_string_lossy(scope))
+      .unwrap_or_default();
+    let length = v8__Coverage__GetScriptLineEnds(raw, script, null_mut(), 0);
+    let mut line_ends = vec![0; length];
+    v8__Coverage__GetScriptLineEnds(
+      raw,
+      script,
+      line_ends.as_mut_ptr(),
+      length,
+    );
+    let functions = (0..v8__Coverage__FunctionCount(raw, script))
+      .map(|function| FunctionCoverage::from_raw(scope, raw, script, function))
+      .collect();
+    Self {
+      script_id,
+      url,
+      line_ends,
+      functions,
+    }
+  }
+
+  /// Returns the 0-based line number of the line that contains `offset`.
+  pub fn line_number(&self, offset: i32) -> usize {
+    match self.line_ends.binary_search(&offset) {
+      Ok(line) | Err(line) => line,
+    }
+  }
+
+  /// Returns the offset of the first character of the 0-based line `line`.
+  fn line_start(&self, line: usize) -> i32 {
+    match line {
+      0 => 0,
+      _ => self.line_ends[line - 1] + 1,
+    }
+  }
+}
+
+impl FunctionCoverage {
+  unsafe fn from_raw(
+    scope: &mut HandleScope<()>,
+    raw: *const RawCoverage,
+    script: usize,
+    function: usize,
+  ) -> Self {
+    let mut range = CoverageRange {
+      start_offset: 0,
+      end_offset: 0,
+      count: 0,
+    };
+    let mut has_block_coverage = false;
+    let mut block_count = 0;
+    let name = v8__Coverage__GetFunction(
+      raw,
+      script,
+      function,
+      &mut range,
+      &mut has_block_coverage,
+      &mut block_count,
+    );
+    let name = name
+      .as_ref()
+      .map(|name| name.to_rust_string_lossy(scope))
+      .unwrap_or_default();
+    let mut blocks = Vec::with_capacity(block_count);
+    v8__Coverage__GetBlocks(raw, script, function, blocks.as_mut_ptr());
+    blocks.set_len(block_count);
+    Self {
+      name,
+      range,
+      has_block_coverage,
+      blocks,
+    }
+  }
+}
+
+fn write_lcov_script(
+  writer: &mut impl Write,
+  script: &ScriptCoverage,
+) -> io::Result<()> {
+  writeln!(writer, "TN:")?;
+  writeln!(writer, "SF:{}", script.url)?;
+
+  // Function names must be unique within a file.
+  let names = script
+    .functions
+    .iter()
+    .enumerate()
+    .map(|(index, function)| match function.name.as_str() {
+      "" => format!("(anonymous_{})", index),
+      name => name.to_owned(),
+    })
+    .collect::<Vec<_>>();
+  for (function, name) in script.functions.iter().zip(&names) {
+    let line = script.line_number(function.range.start_offset) + 1;
+    writeln!(writer, "FN:{},{}", line, name)?;
+  }
+  for (function, name) in script.functions.iter().zip(&names) {
+    writeln!(writer, "FNDA:{},{}", function.range.count, name)?;
+  }
+  let functions_hit = script
+    .functions
+    .iter()
+    .filter(|f| f.range.count > 0)
+    .count();
+  writeln!(writer, "FNF:{}", script.functions.len())?;
+  writeln!(writer, "FNH:{}", functions_hit)?;
+
+  // Apply the ranges from the outermost to the innermost, so that every line
+  // ends up with the count of the innermost range that contains it. The
+  // sort is stable, so a function comes before a block with the same range.
+  let mut ranges = script
+    .functions
+    .iter()
+    .flat_map(|f| std::iter::once(&f.range).chain(&f.blocks))
+    .collect::<Vec<_>>();
+  ranges.sort_by_key(|range| (range.start_offset, Reverse(range.end_offset)));
+  let mut counts = vec![None; script.line_ends.len()];
+  for range in ranges {
+    let first = script.line_number(range.start_offset);
+    let last = script.line_number(range.end_offset);
+    for line in first..counts.len().min(last + 1) {
+      if script.line_start(line) >= range.start_offset
+        && script.line_ends[line] <= range.end_offset
+      {
+        counts[line] = Some(range.count);
+      }
+    }
+  }
+  let mut lines_found = 0;
+  let mut lines_hit = 0;
+  for (line, count) in counts.into_iter().enumerate() {
+    if let Some(count) = count {
+      writeln!(writer, "DA:{},{}", line + 1, count)?;
+      lines_found += 1;
+      lines_hit += (count > 0) as usize;
+    }
+  }
+  writeln!(writer, "LF:{}", lines_found)?;
+  writeln!(writer, "LH:{}", lines_hit)?;
+  writeln!(writer, "end_of_record")
+}
+
+#[cfg(test)]
+mod tests {
+  use super::*;
+
+  fn range(start_offset: i32, end_offset: i32, count: u32) -> CoverageRange {
+    CoverageRange {
+      start_offset,
+      end_offset,
+      count,
+    }
+  }
+
+  #[test]
+  fn test_write_lcov() {
+    // function f(x) {
+    //   if (x) {
+    //     return 1;
+    //   }
+    //   return 2;
+    // }
+    // f(0); f(0);
+    let source = "function f(x) {\n  if (x) {\n    return 1;\n  }\n  \
+                  return 2;\n}\nf(0); f(0);\n";
+    let line_ends = source
+      .char_indices()
+      .filter(|&(_, c)| c == '\n')
+      .map(|(i, _)| i as i32)
+      .collect::<Vec<_>>();
+    let block_start = source.find("{\n    return 1").unwrap() as i32;
+    let block_end = source.find("\n  return 2").unwrap() as i32;
+    let f_end = source.find("\nf(0)").unwrap() as i32;
+    let coverage = Coverage {
+      scripts: vec![
+        ScriptCoverage {
+          script_id: 1,
+          url: "file:///f.js".to_owned(),
+          line_ends,
+          functions: vec![
+            FunctionCoverage {
+              name: "".to_owned(),
+              range: range(0, source.len() as i32, 1),
+              has_block_coverage: true,
+              blocks: vec![],
+            },
+            FunctionCoverage {
+              name: "f".to_owned(),
+              range: range(0, f_end, 2),
+              has_block_coverage: true,
+              blocks: vec![range(block_start, block_end, 0)],
+            },
+          ],
+        },
+        ScriptCoverage {
+          script_id: 2,
+          url: "".to_owned(),
+          line_ends: vec![],
+          functions: vec![],
+        },
+      ],
+    };
+    let mut lcov = Vec::new();
+    coverage.write_lcov(&mut lcov).unwrap();
+    let expected = "TN:\nSF:file:///f.js\n\
+                    FN:1,(anonymous_0)\nFN:1,f\n\
+                    FNDA:1,(anonymous_0)\nFNDA:2,f\n\
+                    FNF:2\nFNH:2\n\
+                    DA:1,2\nDA:2,2\nDA:3,0\nDA:4,0\nDA:5,2\nDA:6,2\nDA:7,1\n\
+                    LF:7\nLH:5\nend_of_record\n";
+    assert_eq!(std::str::from_utf8(&lcov).unwrap(), expected);
+  }
+}
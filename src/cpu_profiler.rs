@@ -0,0 +1,664 @@
+// Copyright 2019-2021 the Deno authors. All rights reserved. MIT license.
+
+use std::borrow::Cow;
+use std::cell::Cell;
+use std::ffi::CStr;
+use std::io;
+use std::io::Write;
+use std::os::raw::c_char;
+use std::ptr;
+use std::ptr::null_mut;
+use std::ptr::NonNull;
+use std::rc::Rc;
+use std::time::SystemTime;
+use std::time::UNIX_EPOCH;
+
+use crate::pprof;
+use crate::pprof::ProfileNode;
+use crate::pprof::ProfileWriter;
+use crate::support::int;
+use crate::support::Opaque;
+use crate::HandleScope;
+use crate::Isolate;
+use crate::Local;
+use crate::String;
+
+extern "C" {
+  fn v8__CpuProfiler__New(
+    isolate: *mut Isolate,
+    naming_mode: CpuProfilingNamingMode,
+    logging_mode: CpuProfilingLoggingMode,
+  ) -> *mut RawCpuProfiler;
+  fn v8__CpuProfiler__Dispose(this: *mut RawCpuProfiler);
+  fn v8__CpuProfiler__SetSamplingInterval(this: *const RawCpuProfiler, us: int);
+  fn v8__CpuProfiler__SetUsePreciseSampling(
+    this: *const RawCpuProfiler,
+    use_precise_sampling: bool,
+  );
+  fn v8__CpuProfiler__StartProfiling(
+    this: *const RawCpuProfiler,
+    title: *const String,
+    mode: CpuProfilingMode,
+    max_samples: u32,
+    sampling_interval_us: int,
+  ) -> CpuProfilingStatus;
+  fn v8__CpuProfiler__StopProfiling(
+    this: *const RawCpuProfiler,
+    title: *const String,
+  ) -> *mut RawCpuProfile;
+
+  fn v8__CpuProfile__Delete(this: *mut RawCpuProfile);
+  fn v8__CpuProfile__GetTitle(this: *const RawCpuProfile) -> *const String;
+  fn v8__CpuProfile__GetTopDownRoot(
+    this: *const RawCpuProfile,
+  ) -> *const CpuProfileNode;
+  fn v8__CpuProfile__GetSamplesCount(this: *const RawCpuProfile) -> int;
+  fn v8__CpuProfile__GetSample(
+    this: *const RawCpuProfile,
+    index: int,
+  ) -> *const CpuProfileNode;
+  fn v8__CpuProfile__GetSampleTimestamp(
+    this: *const RawCpuProfile,
+    index: int,
+  ) -> i64;
+  fn v8__CpuProfile__GetStartTime(this: *const RawCpuProfile) -> i64;
+  fn v8__CpuProfile__GetEndTime(this: *const RawCpuProfile) -> i64;
+
+  fn v8__CpuProfileNode__GetFunctionNameStr(
+    this: *const CpuProfileNode,
+  ) -> *const c_char;
+  fn v8__CpuProfileNode__GetScriptId(this: *const CpuProfileNode) -> int;
+  fn v8__CpuProfileNode__GetScriptResourceNameStr(
+    this: *const CpuProfileNode,
+  ) -> *const c_char;
+  fn v8__CpuProfileNode__GetLineNumber(this: *const CpuProfileNode) -> int;
+  fn v8__CpuProfileNode__GetColumnNumber(this: *const CpuProfileNode) -> int;
+  fn v8__CpuProfileNode__GetBailoutReason(
+    this: *const CpuProfileNode,
+  ) -> *const c_char;
+  fn v8__CpuProfileNode__GetHitCount(this: *const CpuProfileNode) -> u32;
+  fn v8__CpuProfileNode__GetNodeId(this: *const CpuProfileNode) -> u32;
+  fn v8__CpuProfileNode__GetParent(
+    this: *const CpuProfileNode,
+  ) -> *const CpuProfileNode;
+  fn v8__CpuProfileNode__GetChildrenCount(this: *const CpuProfileNode) -> int;
+  fn v8__CpuProfileNode__GetChild(
+    this: *const CpuProfileNode,
+    index: int,
+  ) -> *const CpuProfileNode;
+}
+
+/// Which line numbers are attributed to the nodes of a profile.
+#[derive(Debug, Clone, Copy, PartialEq)]
+#[repr(C)]
+pub enum CpuProfilingMode {
+  /// A profile node has the line number of the function it belongs to.
+  /// Samples of different lines of a function are merged.
+  LeafNodeLineNumbers,
+  /// Callers are split into separate nodes by the line number at which they
+  /// call the next function on the stack.
+  CallerLineNumbers,
+}
+
+/// How functions are named in profiles.
+#[derive(Debug, Clone, Copy, PartialEq)]
+#[repr(C)]
+pub enum CpuProfilingNamingMode {
+  /// Use the function's own name only.
+  StandardNaming,
+  /// Use the name that V8 infers for anonymous functions too, e.g. the name
+  /// of the variable or property they are assigned to.
+  DebugNaming,
+}
+
+/// When code events are logged for the profiler.
+#[derive(Debug, Clone, Copy, PartialEq)]
+#[repr(C)]
+pub enum CpuProfilingLoggingMode {
+  /// Only log code events while a profile is being recorded. Starting a
+  /// profile is slower, but there is no overhead when not profiling.
+  LazyLogging,
+  /// Log code events for as long as the profiler exists, so that profiles
+  /// can be started quickly.
+  EagerLogging,
+}
+
+#[derive(Debug, Clone, Copy, PartialEq)]
+#[repr(C)]
+pub enum CpuProfilingStatus {
+  Started,
+  AlreadyStarted,
+  ErrorTooManyProfilers,
+}
+
+#[derive(Debug, Clone)]
+pub struct CpuProfilingOptions {
+  pub mode: CpuProfilingMode,
+  /// The maximum number of samples to record with their timestamps (see
+  /// `CpuProfile::sample()`); the tree of hit counts is built regardless.
+  /// Zero disables recording samples.
+  pub max_samples: u32,
+  /// The sampling interval for this profile in microseconds, or zero to use
+  /// the profiler's interval (see `CpuProfiler::set_sampling_interval()`).
+  /// If several profiles are recorded at the same time, the sampling
+  /// interval is their greatest common divisor.
+  pub sampling_interval_us: i32,
+}
+
+impl Default for CpuProfilingOptions {
+  fn default() -> Self {
+    Self {
+      mode: CpuProfilingMode::LeafNodeLineNumbers,
+      max_samples: u32::MAX,
+      sampling_interval_us: 0,
+    }
+  }
+}
+
+/// Samples the JavaScript stack of an isolate at regular intervals from a
+/// separate thread and builds profiles of where the time is spent.
+///
+/// ```ignore
+/// let profiler = v8::CpuProfiler::new(
+///   isolate,
+///   v8::CpuProfilingNamingMode::DebugNaming,
+///   v8::CpuProfilingLoggingMode::LazyLogging,
+/// );
+/// let title = v8::String::empty(scope);
+/// profiler.start_profiling(title, &Default::default());
+/// // ... run some JavaScript ...
+/// let profile = profiler.stop_profiling(title).unwrap();
+/// let file = std::fs::File::create("trace.cpuprofile")?;
+/// profile.write_cpuprofile(scope, file)?;
+/// ```
+///
+/// V8 requires a profiler to be disposed before its isolate. The isolate
+/// keeps track of its profilers and disposes the ones that are still alive
+/// when it is disposed itself. Such a profiler, and the profiles it
+/// recorded, are detached: their methods return None (or an error).
+#[derive(Debug)]
+pub struct CpuProfiler(Rc<CpuProfilerState>);
+
+#[repr(C)]
+struct RawCpuProfiler(Opaque);
+
+#[derive(Debug)]
+struct CpuProfilerState {
+  /// Null once the profiler has been disposed.
+  raw: Cell<*mut RawCpuProfiler>,
+  isolate: *const Isolate,
+}
+
+impl CpuProfilerState {
+  fn dispose(&self) {
+    let raw = self.raw.replace(null_mut());
+    if !raw.is_null() {
+      unsafe { v8__CpuProfiler__Dispose(raw) }
+    }
+  }
+}
+
+/// The profilers of an isolate, kept in an isolate slot so that they are
+/// disposed before the isolate. The type is private to this module, so the
+/// slot can't be replaced from outside.
+struct CpuProfilers(Vec<Rc<CpuProfilerState>>);
+
+impl Drop for CpuProfilers {
+  fn drop(&mut self) {
+    // The profiles that are still alive are deleted along with their
+    // profiler. Nodes borrowed from them borrow the isolate as well (see
+    // `CpuProfile::top_down_root()`), so none can be left dangling.
+    for state in &self.0 {
+      state.dispose();
+    }
+  }
+}
+
+impl CpuProfiler {
+  pub fn new(
+    isolate: &mut Isolate,
+    naming_mode: CpuProfilingNamingMode,
+    logging_mode: CpuProfilingLoggingMode,
+  ) -> Self {
+    let raw =
+      unsafe { v8__CpuProfiler__New(isolate, naming_mode, logging_mode) };
+    let state = Rc::new(CpuProfilerState {
+      raw: Cell::new(raw),
+      isolate,
+    });
+    match isolate.get_slot_mut::<CpuProfilers>() {
+      Some(profilers) => {
+        profilers.0.retain(|state| !state.raw.get().is_null());
+        profilers.0.push(state.clone());
+      }
+      None => {
+        isolate.set_slot(CpuProfilers(vec![state.clone()]));
+      }
+    }
+    Self(state)
+  }
+
+  /// Changes the default sampling interval (1000 microseconds). This only
+  /// affects profiles that are started afterwards. Returns None if the
+  /// isolate has been disposed.
+  pub fn set_sampling_interval(&self, us: i32) -> Option<()> {
+    unsafe { v8__CpuProfiler__SetSamplingInterval(self.raw()?, us) }
+    Some(())
+  }
+
+  /// Sets whether the sampling thread busy-waits for the next sample instead
+  /// of sleeping, which is more precise but uses a lot more CPU time. This
+  /// only has an effect on Windows. Returns None if the isolate has been
+  /// disposed.
+  pub fn set_use_precise_sampling(
+    &self,
+    use_precise_sampling: bool,
+  ) -> Option<()> {
+    unsafe {
+      v8__CpuProfiler__SetUsePreciseSampling(self.raw()?, use_precise_sampling)
+    }
+    Some(())
+  }
+
+  /// Starts recording a profile. Profiles with different titles can be
+  /// recorded at the same time; starting a profile that is already being
+  /// recorded has no effect. Returns None if the isolate has been disposed.
+  pub fn start_profiling(
+    &self,
+    title: Local<String>,
+    options: &CpuProfilingOptions,
+  ) -> Option<CpuProfilingStatus> {
+    let status = unsafe {
+      v8__CpuProfiler__StartProfiling(
+        self.raw()?,
+        &*title,
+        options.mode,
+        options.max_samples,
+        options.sampling_interval_us,
+      )
+    };
+    Some(status)
+  }
+
+  /// Stops recording the profile with the given title and returns it, or
+  /// None if no such profile was started or the isolate has been disposed.
+  pub fn stop_profiling(&self, title: Local<String>) -> Option<CpuProfile<'_>> {
+    let raw = unsafe { v8__CpuProfiler__StopProfiling(self.raw()?, &*title) };
+    Some(CpuProfile {
+      raw: NonNull::new(raw)?,
+      profiler: self,
+    })
+  }
+
+  fn raw(&self) -> Option<*const RawCpuProfiler> {
+    let raw = self.0.raw.get();
+    if raw.is_null() {
+      None
+    } else {
+      Some(raw)
+    }
+  }
+}
+
+impl Drop for CpuProfiler {
+  fn drop(&mut self) {
+    self.0.dispose()
+  }
+}
+
+#[repr(C)]
+struct RawCpuProfile(Opaque);
+
+/// A profile recorded by a `CpuProfiler`, in the form of a tree of call
+/// stacks ("top down") with the number of samples that were taken in each,
+/// plus the list of samples in the order they were taken. The profile is
+/// deleted when dropped, and can't outlive the profiler. Its data is owned
+/// by the profiler, so its methods return None (or an error) once the
+/// isolate has been disposed.
+pub struct CpuProfile<'a> {
+  raw: NonNull<RawCpuProfile>,
+  profiler: &'a CpuProfiler,
+}
+
+impl<'a> CpuProfile<'a> {
+  pub fn title<'s>(
+    &self,
+    scope: &mut HandleScope<'s, ()>,
+  ) -> Option<Local<'s, String>> {
+    let raw = self.raw_in(scope)?;
+    unsafe { scope.cast_local(|_| v8__CpuProfile__GetTitle(raw)) }
+  }
+
+  /// Returns the root node of the call tree. The nodes borrow the profile's
+  /// `isolate`, which keeps it from being disposed while they are in use;
+  /// returns None if `isolate` isn't the profiler's isolate or the isolate
+  /// has been disposed.
+  pub fn top_down_root<'p>(
+    &'p self,
+    isolate: &'p Isolate,
+  ) -> Option<&'p CpuProfileNode> {
+    let raw = self.raw_in(isolate)?;
+    Some(unsafe { &*v8__CpuProfile__GetTopDownRoot(raw) })
+  }
+
+  pub fn samples_count(&self) -> Option<usize> {
+    let raw = self.raw()?;
+    Some(unsafe { v8__CpuProfile__GetSamplesCount(raw) as usize })
+  }
+
+  /// Returns the leaf node of the stack that was sampled by sample `index`.
+  /// See `top_down_root()` for `isolate`.
+  pub fn sample<'p>(
+    &'p self,
+    isolate: &'p Isolate,
+    index: usize,
+  ) -> Option<&'p CpuProfileNode> {
+    let raw = self.raw_in(isolate)?;
+    assert!(index < self.samples_count()?);
+    Some(unsafe { &*v8__CpuProfile__GetSample(raw, index as int) })
+  }
+
+  /// Returns the time at which sample `index` was taken, in microseconds on
+  /// the same clock as `start_time()`.
+  pub fn sample_timestamp(&self, index: usize) -> Option<i64> {
+    let raw = self.raw()?;
+    assert!(index < self.samples_count()?);
+    Some(unsafe { v8__CpuProfile__GetSampleTimestamp(raw, index as int) })
+  }
+
+  /// Returns the time at which recording started, in microseconds. The clock
+  /// is monotonic; its origin is unspecified.
+  pub fn start_time(&self) -> Option<i64> {
+    let raw = self.raw()?;
+    Some(unsafe { v8__CpuProfile__GetStartTime(raw) })
+  }
+
+  /// Returns the time at which recording stopped, in microseconds.
+  pub fn end_time(&self) -> Option<i64> {
+    let raw = self.raw()?;
+    Some(unsafe { v8__CpuProfile__GetEndTime(raw) })
+  }
+
+  /// Writes the profile in the JSON format of Chrome DevTools' `.cpuprofile`
+  /// files (the `Profile` type of the DevTools protocol). The profile is
+  /// streamed to `writer`, which is not buffered by this function.
+  pub fn write_cpuprofile(
+    &self,
+    isolate: &Isolate,
+    mut writer: impl Write,
+  ) -> io::Result<()> {
+    let root = self.top_down_root(isolate).ok_or_else(detached)?;
+    let (start_time, end_time) = (self.start_time(), self.end_time());
+    let (start_time, end_time) = (start_time.unwrap(), end_time.unwrap());
+    let count = self.samples_count().unwrap();
+
+    let w = &mut writer;
+    w.write_all(b"{\"nodes\":[")?;
+    let mut result = Ok(());
+    root.walk(|path| {
+      let node = *path.last().unwrap();
+      if result.is_ok() {
+        let separator = if path.len() == 1 { "" } else { "," };
+        result = w
+          .write_all(separator.as_bytes())
+          .and_then(|_| write_cpuprofile_node(w, node));
+      }
+    });
+    result?;
+    write!(
+      w,
+      "],\"startTime\":{},\"endTime\":{},\"samples\":[",
+      start_time, end_time
+    )?;
+    for i in 0..count {
+      let separator = if i == 0 { "" } else { "," };
+      let node = self.sample(isolate, i).unwrap();
+      write!(w, "{}{}", separator, node.node_id())?;
+    }
+    w.write_all(b"],\"timeDeltas\":[")?;
+    let mut previous = start_time;
+    for i in 0..count {
+      let separator = if i == 0 { "" } else { "," };
+      let timestamp = self.sample_timestamp(i).unwrap();
+      write!(w, "{}{}", separator, timestamp - previous)?;
+      previous = timestamp;
+    }
+    w.write_all(b"]}")?;
+    w.flush()
+  }
+
+  /// Writes the profile in pprof's protocol buffer format, uncompressed.
+  /// Every call stack in the tree that was hit becomes a sample with two
+  /// values: the number of hits and the CPU time in nanoseconds, estimated
+  /// from the average sampling interval. The profile is streamed to
+  /// `writer`, which is not buffered by this function.
+  pub fn write_pprof(
+    &self,
+    isolate: &Isolate,
+    writer: impl Write,
+  ) -> io::Result<()> {
+    let root = self.top_down_root(isolate).ok_or_else(detached)?;
+    let mut total_hits = 0u64;
+    root.walk(|path| total_hits += path.last().unwrap().hit_count() as u64);
+    let duration_nanos =
+      (self.end_time().unwrap() - self.start_time().unwrap()) * 1000;
+    let period = if total_hits == 0 {
+      0
+    } else {
+      duration_nanos / total_hits as i64
+    };
+    let now = SystemTime::now()
+      .duration_since(UNIX_EPOCH)
+      .map_or(0, |d| d.as_nanos() as i64);
+
+    let mut profile = ProfileWriter::new(
+      writer,
+      &[("samples", "count"), ("cpu", "nanoseconds")],
+      ("cpu", "nanoseconds"),
+      period,
+    )?;
+    let mut result = Ok(());
+    root.walk(|path| {
+      if result.is_ok() {
+        let hits = path.last().unwrap().hit_count() as i64;
+        result = profile.node(path, &[hits, hits * period]);
+      }
+    });
+    result?;
+    profile.finish(now - duration_nanos, duration_nanos)?;
+    Ok(())
+  }
+
+  /// Returns None once the profiler has been disposed, which deletes the
+  /// profile.
+  fn raw(&self) -> Option<*const RawCpuProfile> {
+    self.profiler.raw()?;
+    Some(self.raw.as_ptr())
+  }
+
+  fn raw_in(&self, isolate: &Isolate) -> Option<*const RawCpuProfile> {
+    if ptr::eq(isolate, self.profiler.0.isolate) {
+      self.raw()
+    } else {
+      None
+    }
+  }
+}
+
+impl<'a> Drop for CpuProfile<'a> {
+  fn drop(&mut self) {
+    if self.raw().is_some() {
+      unsafe { v8__CpuProfile__Delete(self.raw.as_ptr()) }
+    }
+  }
+}
+
+fn detached() -> io::Error {
+  io::Error::new(
+    io::ErrorKind::Other,
+    "the profile was recorded in another isolate, or its isolate was disposed",
+  )
+}
+
+/// A node in the call tree of a `CpuProfile`: a function, called through the
+/// chain of functions of its ancestors.
+#[repr(C)]
+#[derive(Debug)]
+pub struct CpuProfileNode(Opaque);
+
+impl CpuProfileNode {
+  /// Returns the name of the function, or an empty string for anonymous
+  /// functions. Nodes that don't represent JavaScript functions have names
+  /// like "(root)", "(program)", "(garbage collector)" or "(idle)".
+  pub fn function_name(&self) -> Cow<'_, str> {
+    unsafe { c_str(v8__CpuProfileNode__GetFunctionNameStr(self)) }
+  }
+
+  pub fn script_id(&self) -> i32 {
+    unsafe { v8__CpuProfileNode__GetScriptId(self) }
+  }
+
+  /// Returns the resource name (usually the URL) of the function's script.
+  pub fn script_resource_name(&self) -> Cow<'_, str> {
+    unsafe { c_str(v8__CpuProfileNode__GetScriptResourceNameStr(self)) }
+  }
+
+  /// Returns the 1-based line number of the function (or, with
+  /// `CpuProfilingMode::CallerLineNumbers`, of the call site), or 0 if
+  /// unknown.
+  pub fn line_number(&self) -> i32 {
+    unsafe { v8__CpuProfileNode__GetLineNumber(self) }
+  }
+
+  /// Returns the 1-based column number of the function, or 0 if unknown.
+  pub fn column_number(&self) -> i32 {
+    unsafe { v8__CpuProfileNode__GetColumnNumber(self) }
+  }
+
+  /// Returns the reason why the function was deoptimized, if it was.
+  pub fn bailout_reason(&self) -> Cow<'_, str> {
+    unsafe { c_str(v8__CpuProfileNode__GetBailoutReason(self)) }
+  }
+
+  /// Returns the number of samples taken with this node at the top of the
+  /// stack.
+  pub fn hit_count(&self) -> u32 {
+    unsafe { v8__CpuProfileNode__GetHitCount(self) }
+  }
+
+  /// Returns the id of the node, which is unique within a profile.
+  pub fn node_id(&self) -> u32 {
+    unsafe { v8__CpuProfileNode__GetNodeId(self) }
+  }
+
+  pub fn parent(&self) -> Option<&CpuProfileNode> {
+    unsafe { v8__CpuProfileNode__GetParent(self).as_ref() }
+  }
+
+  pub fn children_count(&self) -> usize {
+    unsafe { v8__CpuProfileNode__GetChildrenCount(self) as usize }
+  }
+
+  pub fn child(&self, index: usize) -> &CpuProfileNode {
+    assert!(index < self.children_count());
+    unsafe { &*v8__CpuProfileNode__GetChild(self, index as int) }
+  }
+
+  pub fn children(&self) -> impl Iterator<Item = &CpuProfileNode> {
+    (0..self.children_count()).map(move |i| self.child(i))
+  }
+
+  /// Visits this node and all its descendants in depth-first pre-order.
+  /// `f` is called with the path from this node to the visited node, which
+  /// is the last element of the path. The tree is walked without recursion,
+  /// so deep call stacks can't overflow the native stack.
+  pub fn walk<'a>(&'a self, f: impl FnMut(&[&'a CpuProfileNode])) {
+    pprof::walk(self, f)
+  }
+}
+
+impl ProfileNode for CpuProfileNode {
+  fn child_at(&self, index: usize) -> Option<&Self> {
+    if index < self.children_count() {
+      Some(self.child(index))
+    } else {
+      None
+    }
+  }
+
+  fn name(&self) -> Cow<'_, str> {
+    self.function_name()
+  }
+
+  fn file_name(&self) -> Cow<'_, str> {
+    self.script_resource_name()
+  }
+
+  fn line(&self) -> i64 {
+    self.line_number() as i64
+  }
+
+  fn id(&self) -> u64 {
+    self.node_id() as u64
+  }
+}
+
+unsafe fn c_str<'a>(s: *const c_char) -> Cow<'a, str> {
+  if s.is_null() {
+    Cow::Borrowed("")
+  } else {
+    CStr::from_ptr(s).to_string_lossy()
+  }
+}
+
+fn write_cpuprofile_node(
+  w: &mut impl Write,
+  node: &CpuProfileNode,
+) -> io::Result<()> {
+  write!(
+    w,
+    "{{\"id\":{},\"callFrame\":{{\"functionName\":",
+    node.node_id()
+  )?;
+  write_json_string(w, &node.function_name())?;
+  write!(w, ",\"scriptId\":\"{}\",\"url\":", node.script_id())?;
+  write_json_string(w, &node.script_resource_name())?;
+  // DevTools uses 0-based line and column numbers, and -1 if unknown.
+  write!(
+    w,
+    ",\"lineNumber\":{},\"columnNumber\":{}}},\"hitCount\":{},\"children\":[",
+    node.line_number() - 1,
+    node.column_number() - 1,
+    node.hit_count()
+  )?;
+  for (i, child) in node.children().enumerate() {
+    let separator = if i == 0 { "" } else { "," };
+    write!(w, "{}{}", separator, child.node_id())?;
+  }
+  w.write_all(b"]")?;
+  let bailout_reason = node.bailout_reason();
+  if !bailout_reason.is_empty() {
+    w.write_all(b",\"deoptReason\":")?;
+    write_json_string(w, &bailout_reason)?;
+  }
+  w.write_all(b"}")
+}
+
+fn write_json_string(w: &mut impl Write, s: &str) -> io::Result<()> {
+  w.write_all(b"\"")?;
+  let mut start = 0;
+  for (i, c) in s.char_indices() {
+    if c == '"' || c == '\\' || c < ' ' {
+      w.write_all(s[start..i].as_bytes())?;
+      match c {
+        '"' => w.write_all(b"\\\"")?,
+        '\\' => w.write_all(b"\\\\")?,
+        '\n' => w.write_all(b"\\n")?,
+        _ => write!(w, "\\u{:04x}", c as u32)?,
+      }
+      start = i + 1;
+    }
+  }
+  w.write_all(s[start..].as_bytes())?;
+  w.write_all(b"\"")
+}
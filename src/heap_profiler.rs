@@ -0,0 +1,240 @@
+// Copyright 2019-2021 the Deno authors. All rights reserved. MIT license.
+
+use std::borrow::Cow;
+use std::io;
+use std::io::Write;
+use std::slice;
+
+use crate::pprof;
+use crate::pprof::ProfileNode;
+use crate::pprof::ProfileWriter;
+use crate::support::int;
+use crate::support::Opaque;
+use crate::HandleScope;
+use crate::String;
+
+extern "C" {
+  fn v8__AllocationProfile__DELETE(this: *mut RawAllocationProfile);
+  fn v8__AllocationProfile__GetRootNode(
+    this: *mut RawAllocationProfile,
+  ) -> *const RawNode;
+  fn v8__AllocationProfile__GetSamples(
+    this: *mut RawAllocationProfile,
+    length: *mut usize,
+  ) -> *const AllocationProfileSample;
+
+  fn v8__AllocationProfile__Node__name(this: *const RawNode) -> *const String;
+  fn v8__AllocationProfile__Node__script_name(
+    this: *const RawNode,
+  ) -> *const String;
+  fn v8__AllocationProfile__Node__script_id(this: *const RawNode) -> int;
+  fn v8__AllocationProfile__Node__start_position(this: *const RawNode) -> int;
+  fn v8__AllocationProfile__Node__line_number(this: *const RawNode) -> int;
+  fn v8__AllocationProfile__Node__column_number(this: *const RawNode) -> int;
+  fn v8__AllocationProfile__Node__node_id(this: *const RawNode) -> u32;
+  fn v8__AllocationProfile__Node__children(
+    this: *const RawNode,
+    length: *mut usize,
+  ) -> *const *const RawNode;
+  fn v8__AllocationProfile__Node__allocations(
+    this: *const RawNode,
+    length: *mut usize,
+  ) -> *const AllocationProfileAllocation;
+}
+
+#[repr(C)]
+pub(crate) struct RawAllocationProfile(Opaque);
+
+#[repr(C)]
+struct RawNode(Opaque);
+
+/// The live objects sampled by the sampling heap profiler (see
+/// `Isolate::start_sampling_heap_profiler()`), as a tree of the JavaScript
+/// stacks that allocated them.
+#[derive(Debug, Clone)]
+pub struct AllocationProfile {
+  pub root: AllocationProfileNode,
+  /// Every sampled object that is still alive, in no particular order.
+  pub samples: Vec<AllocationProfileSample>,
+}
+
+/// An allocation site: a function, called through the chain of functions of
+/// its ancestors in the tree.
+#[derive(Debug, Clone)]
+pub struct AllocationProfileNode {
+  /// The name of the function, or an empty string for anonymous functions.
+  /// Allocations that didn't happen in JavaScript are attributed to nodes
+  /// like "(V8 API)" or "(GC)".
+  pub name: std::string::String,
+  pub script_name: std::string::String,
+  pub script_id: i32,
+  /// The offset of the function in the script's source.
+  pub start_position: i32,
+  /// The 1-based line number of the function, or 0 if unknown.
+  pub line_number: i32,
+  /// The 1-based column number of the function, or 0 if unknown.
+  pub column_number: i32,
+  /// An id that is unique within the profile; samples refer to it.
+  pub node_id: u32,
+  pub children: Vec<AllocationProfileNode>,
+  /// The sampled objects allocated directly by this function (and not by
+  /// its callees), grouped by size.
+  pub allocations: Vec<AllocationProfileAllocation>,
+}
+
+#[repr(C)]
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct AllocationProfileAllocation {
+  /// The size of each object, in bytes.
+  pub size: usize,
+  /// The estimated number of live objects of this size: the number of
+  /// samples scaled up by the sampling rate.
+  pub count: u32,
+}
+
+#[repr(C)]
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct AllocationProfileSample {
+  /// The id of the node that allocated the object.
+  pub node_id: u32,
+  /// The size of the object, in bytes.
+  pub size: usize,
+  /// The number of objects of this size the sample stands for.
+  pub count: u32,
+  /// An id that is unique for every sample, and increases monotonically with
+  /// the time at which the object was allocated.
+  pub sample_id: u64,
+}
+
+impl AllocationProfile {
+  /// Copies the profile out of V8's representation and deletes it.
+  pub(crate) unsafe fn from_raw(
+    scope: &mut HandleScope<()>,
+    raw: *mut RawAllocationProfile,
+  ) -> Self {
+    let root = v8__AllocationProfile__GetRootNode(raw);
+    let root = AllocationProfileNode::from_raw(scope, &*root);
+    let mut length = 0;
+    let samples = v8__AllocationProfile__GetSamples(raw, &mut length);
+    let samples = raw_slice(samples, length).to_vec();
+    v8__AllocationProfile__DELETE(raw);
+    Self { root, samples }
+  }
+
+  /// Writes the profile in pprof's protocol buffer format, uncompressed.
+  /// Every node with allocations becomes a sample with two values: the
+  /// estimated number of live objects allocated by that stack, and their
+  /// total size in bytes. `sample_interval` is the interval the profiler was
+  /// started with; it is recorded as the profile's period.
+  pub fn write_pprof(
+    &self,
+    writer: impl Write,
+    sample_interval: u64,
+  ) -> io::Result<()> {
+    let mut profile = ProfileWriter::new(
+      writer,
+      &[("objects", "count"), ("space", "bytes")],
+      ("space", "bytes"),
+      sample_interval as i64,
+    )?;
+    let mut result = Ok(());
+    self.root.walk(|path| {
+      if result.is_ok() {
+        let (count, size) = path.last().unwrap().self_size();
+        result = profile.node(path, &[count as i64, size as i64]);
+      }
+    });
+    result?;
+    profile.finish(0, 0)?;
+    Ok(())
+  }
+}
+
+impl AllocationProfileNode {
+  unsafe fn from_raw(scope: &mut HandleScope<()>, raw: &RawNode) -> Self {
+    // The tree is at most as deep as the `stack_depth` that the profiler was
+    // started with, so it is converted recursively.
+    let mut length = 0;
+    let children = v8__AllocationProfile__Node__children(raw, &mut length);
+    let children = raw_slice(children, length)
+      .iter()
+      .map(|&child| Self::from_raw(scope, &*child))
+      .collect();
+    let allocations =
+      v8__AllocationProfile__Node__allocations(raw, &mut length);
+    let allocations = raw_slice(allocations, length).to_vec();
+    let name = &*v8__AllocationProfile__Node__name(raw);
+    let script_name = &*v8__AllocationProfile__Node__script_name(raw);
+    Self {
+      name: name.to_rust_string_lossy(scope),
+      script_name: script_name.to_rust_string_lossy(scope),
+      script_id: v8__AllocationProfile__Node__script_id(raw),
+      start_position: v8__AllocationProfile__Node__start_position(raw),
+      line_number: v8__AllocationProfile__Node__line_number(raw),
+      column_number: v8__AllocationProfile__Node__column_number(raw),
+      node_id: v8__AllocationProfile__Node__node_id(raw),
+      children,
+      allocations,
+    }
+  }
+
+  /// Returns the estimated number of live objects and their total size in
+  /// bytes, for the objects allocated directly by this node.
+  pub fn self_size(&self) -> (u64, u64) {
+    self.allocations.iter().fold((0, 0), |(count, size), a| {
+      (
+        count + a.count as u64,
+        size + a.count as u64 * a.size as u64,
+      )
+    })
+  }
+
+  /// Like `self_size()`, but includes the objects allocated by the node's
+  /// descendants.
+  pub fn total_size(&self) -> (u64, u64) {
+    let mut total = (0, 0);
+    self.walk(|path| {
+      let (count, size) = path.last().unwrap().self_size();
+      total.0 += count;
+      total.1 += size;
+    });
+    total
+  }
+
+  /// Visits this node and all its descendants in depth-first pre-order.
+  /// `f` is called with the path from this node to the visited node, which
+  /// is the last element of the path.
+  pub fn walk<'a>(&'a self, f: impl FnMut(&[&'a AllocationProfileNode])) {
+    pprof::walk(self, f)
+  }
+}
+
+impl ProfileNode for AllocationProfileNode {
+  fn child_at(&self, index: usize) -> Option<&Self> {
+    self.children.get(index)
+  }
+
+  fn name(&self) -> Cow<'_, str> {
+    Cow::Borrowed(&self.name)
+  }
+
+  fn file_name(&self) -> Cow<'_, str> {
+    Cow::Borrowed(&self.script_name)
+  }
+
+  fn line(&self) -> i64 {
+    self.line_number as i64
+  }
+
+  fn id(&self) -> u64 {
+    self.node_id as u64
+  }
+}
+
+unsafe fn raw_slice<'a, T>(data: *const T, length: usize) -> &'a [T] {
+  if length == 0 {
+    &[]
+  } else {
+    slice::from_raw_parts(data, length)
+  }
+}
@@ -0,0 +1,236 @@
+// Copyright 2019-2021 the Deno authors. All rights reserved. MIT license.
+
+use std::cell::Cell;
+use std::cell::RefCell;
+use std::fs::File;
+use std::io;
+use std::io::Write;
+use std::path::Path;
+use std::sync::atomic::AtomicU64;
+use std::sync::atomic::Ordering;
+use std::sync::mpsc;
+use std::sync::Arc;
+use std::thread;
+
+use crate::Isolate;
+
+#[cfg(feature = "gzip")]
+use flate2::write::GzEncoder;
+
+#[derive(Debug, Clone)]
+pub struct HeapSnapshotWriteOptions {
+  /// The size of the buffers in which the serialized snapshot is handed to
+  /// the writer thread.
+  pub buffer_size: usize,
+  /// The number of full buffers that may be waiting for the writer thread
+  /// before taking the snapshot is paused. At most `max_buffers + 2` buffers
+  /// are allocated at any time.
+  pub max_buffers: usize,
+}
+
+impl Default for HeapSnapshotWriteOptions {
+  fn default() -> Self {
+    Self {
+      buffer_size: 1 << 20,
+      max_buffers: 4,
+    }
+  }
+}
+
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum HeapSnapshotProgress {
+  /// The snapshot is being built; `done` out of `total` steps are done.
+  Building { done: u32, total: u32 },
+  /// The snapshot is being serialized: `bytes_in` bytes of JSON have been
+  /// produced so far, and `bytes_out` bytes have left the writer thread:
+  /// the bytes handed to the writer by `Isolate::write_heap_snapshot()`, or
+  /// the (compressed) bytes written to the file by
+  /// `Isolate::write_heap_snapshot_to_file()`.
+  Writing { bytes_in: u64, bytes_out: u64 },
+}
+
+/// How `Isolate::write_heap_snapshot_to_file()` compresses the snapshot.
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum HeapSnapshotCompression {
+  None,
+  /// Gzip with the given level, from 0 (none) to 9 (best). Requires the
+  /// `gzip` feature.
+  #[cfg(feature = "gzip")]
+  Gzip(u32),
+}
+
+/// Counts the bytes written to the inner writer.
+struct CountingWriter<W> {
+  inner: W,
+  count: Arc<AtomicU64>,
+}
+
+impl<W: Write> Write for CountingWriter<W> {
+  fn write(&mut self, buf: &[u8]) -> io::Result<usize> {
+    let n = self.inner.write(buf)?;
+    self.count.fetch_add(n as u64, Ordering::Relaxed);
+    Ok(n)
+  }
+
+  fn flush(&mut self) -> io::Result<()> {
+    self.inner.flush()
+  }
+}
+
+enum FileSink {
+  Plain(CountingWriter<File>),
+  #[cfg(feature = "gzip")]
+  Gzip(GzEncoder<CountingWriter<File>>),
+}
+
+impl FileSink {
+  fn finish(self) -> io::Result<()> {
+    let mut file = match self {
+      Self::Plain(file) => file,
+      #[cfg(feature = "gzip")]
+      Self::Gzip(encoder) => encoder.finish()?,
+    };
+    file.flush()
+  }
+}
+
+impl Write for FileSink {
+  fn write(&mut self, buf: &[u8]) -> io::Result<usize> {
+    match self {
+      Self::Plain(file) => file.write(buf),
+      #[cfg(feature = "gzip")]
+      Self::Gzip(encoder) => encoder.write(buf),
+    }
+  }
+
+  fn flush(&mut self) -> io::Result<()> {
+    match self {
+      Self::Plain(file) => file.flush(),
+      #[cfg(feature = "gzip")]
+      Self::Gzip(encoder) => encoder.flush(),
+    }
+  }
+}
+
+pub(crate) fn write_heap_snapshot<W: Write + Send + 'static>(
+  isolate: &mut Isolate,
+  writer: W,
+  options: &HeapSnapshotWriteOptions,
+  progress: impl FnMut(HeapSnapshotProgress) -> bool,
+) -> io::Result<W> {
+  let bytes_out = Arc::new(AtomicU64::new(0));
+  let writer = CountingWriter {
+    inner: writer,
+    count: bytes_out.clone(),
+  };
+  write_counted(isolate, writer, &bytes_out, options, progress)
+    .map(|writer| writer.inner)
+}
+
+pub(crate) fn write_heap_snapshot_to_file(
+  isolate: &mut Isolate,
+  path: &Path,
+  compression: HeapSnapshotCompression,
+  options: &HeapSnapshotWriteOptions,
+  progress: impl FnMut(HeapSnapshotProgress) -> bool,
+) -> io::Result<u64> {
+  let bytes_out = Arc::new(AtomicU64::new(0));
+  let file = CountingWriter {
+    inner: File::create(path)?,
+    count: bytes_out.clone(),
+  };
+  let sink = match compression {
+    HeapSnapshotCompression::None => FileSink::Plain(file),
+    #[cfg(feature = "gzip")]
+    HeapSnapshotCompression::Gzip(level) => FileSink::Gzip(GzEncoder::new(
+      file,
+      flate2::Compression::new(level.min(9)),
+    )),
+  };
+  write_counted(isolate, sink, &bytes_out, options, progress)?.finish()?;
+  Ok(bytes_out.load(Ordering::Relaxed))
+}
+
+/// Streams a heap snapshot to `writer` on a background thread. `bytes_out`
+/// is reported as progress; it is updated by the writer.
+fn write_counted<W: Write + Send + 'static>(
+  isolate: &mut Isolate,
+  writer: W,
+  bytes_out: &AtomicU64,
+  options: &HeapSnapshotWriteOptions,
+  progress: impl FnMut(HeapSnapshotProgress) -> bool,
+) -> io::Result<W> {
+  let buffer_size = options.buffer_size.max(1);
+  let (full_sender, full_receiver) =
+    mpsc::sync_channel::<Vec<u8>>(options.max_buffers);
+  let (empty_sender, empty_receiver) = mpsc::channel();
+  let writer_thread = thread::Builder::new()
+    .name("heap snapshot writer".to_owned())
+    .spawn(move || -> io::Result<W> {
+      let mut writer = writer;
+      for mut buffer in full_receiver {
+        writer.write_all(&buffer)?;
+        buffer.clear();
+        let _ = empty_sender.send(buffer);
+      }
+      writer.flush()?;
+      Ok(writer)
+    })?;
+
+  let progress = RefCell::new(progress);
+  let aborted = Cell::new(false);
+  let writer_failed = Cell::new(false);
+  let mut buffer = Vec::with_capacity(buffer_size);
+  let mut bytes_in = 0u64;
+  isolate.take_heap_snapshot_with_progress(
+    |chunk| {
+      buffer.extend_from_slice(chunk);
+      bytes_in += chunk.len() as u64;
+      if buffer.len() < buffer_size {
+        return true;
+      }
+      let next = empty_receiver
+        .try_recv()
+        .unwrap_or_else(|_| Vec::with_capacity(buffer_size));
+      // Blocks while `max_buffers` buffers are waiting to be written.
+      if full_sender
+        .send(std::mem::replace(&mut buffer, next))
+        .is_err()
+      {
+        writer_failed.set(true);
+        return false;
+      }
+      let bytes_out = bytes_out.load(Ordering::Relaxed);
+      let keep_going = (progress.borrow_mut())(HeapSnapshotProgress::Writing {
+        bytes_in,
+        bytes_out,
+      });
+      aborted.set(!keep_going);
+      keep_going
+    },
+    |done, total| {
+      let keep_going =
+        (progress.borrow_mut())(HeapSnapshotProgress::Building { done, total });
+      aborted.set(!keep_going);
+      keep_going
+    },
+  );
+  if !buffer.is_empty() && !aborted.get() {
+    let _ = full_sender.send(buffer);
+  }
+  drop(full_sender);
+  let result = writer_thread.join().unwrap();
+
+  if aborted.get() {
+    Err(io::Error::new(
+      io::ErrorKind::Interrupted,
+      "heap snapshot aborted",
+    ))
+  } else if writer_failed.get() || bytes_in == 0 {
+    Err(result.err().unwrap_or_else(|| {
+      io::Error::new(io::ErrorKind::Other, "failed to take heap snapshot")
+    }))
+  } else {
+    result
+  }
+}
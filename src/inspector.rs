@@ -24,6 +24,8 @@ use crate::Context;
 use crate::Isolate;
 use crate::Local;
 use std::fmt::{self, Debug, Formatter};
+use std::sync::mpsc;
+use std::thread;
 
 extern "C" {
   fn v8_inspector__V8Inspector__Channel__BASE__CONSTRUCT(
@@ -326,6 +328,151 @@ impl Debug for ChannelBase {
   }
 }
 
+/// The messages that a `BatchingChannel` collected between two flushes, in
+/// the order in which V8 sent them. The batch owns V8's buffers, so it can
+/// be moved to another thread and read there without copying the payloads.
+#[derive(Default)]
+pub struct MessageBatch {
+  messages: Vec<(Option<i32>, UniqueRef<StringBuffer>)>,
+}
+
+impl MessageBatch {
+  pub fn len(&self) -> usize {
+    self.messages.len()
+  }
+
+  pub fn is_empty(&self) -> bool {
+    self.messages.is_empty()
+  }
+
+  /// Iterates over the messages as views of V8's buffers. The call id is
+  /// `Some` for responses and `None` for notifications.
+  pub fn iter(&self) -> impl Iterator<Item = (Option<i32>, StringView)> {
+    self
+      .messages
+      .iter()
+      .map(|(call_id, message)| (*call_id, message.string()))
+  }
+
+  /// Converts every message to a UTF-8 string. The JSON that V8 produces is
+  /// almost always ASCII, which is copied as is; other 8-bit messages are
+  /// decoded as Latin-1, and 16-bit ones as UTF-16.
+  pub fn to_utf8(&self) -> Vec<(Option<i32>, string::String)> {
+    self
+      .iter()
+      .map(|(call_id, message)| (call_id, string_view_to_utf8(message)))
+      .collect()
+  }
+
+  fn push(&mut self, call_id: Option<i32>, message: UniquePtr<StringBuffer>) {
+    self.messages.push((call_id, message.unwrap()));
+  }
+}
+
+// The buffers are owned by the batch and never shared, and StringBuffer is
+// Send.
+unsafe impl Send for MessageBatch {}
+
+fn string_view_to_utf8(view: StringView) -> string::String {
+  match view {
+    StringView::U8(chars) if chars.is_ascii() => {
+      string::String::from_utf8(chars.to_vec()).unwrap()
+    }
+    StringView::U8(chars) => chars.iter().cloned().map(char::from).collect(),
+    StringView::U16(chars) => string::String::from_utf16_lossy(&chars),
+  }
+}
+
+/// A channel that queues the notifications V8 sends to a session, and hands
+/// them to a sink in one `MessageBatch` when V8 calls
+/// `flush_protocol_notifications()`, instead of one at a time.
+///
+/// A response flushes the queue right away, so that the frontend receives it
+/// without delay and after the notifications that preceded it. V8 only
+/// flushes notifications at some points, like when execution pauses, so the
+/// embedder should also call `flush()` when it is done running JavaScript,
+/// e.g. at the end of every task of its event loop.
+///
+/// The sink is called on the isolate's thread, from inside V8's calls to the
+/// channel, so it must not call back into the inspector session.
+pub struct BatchingChannel {
+  base: ChannelBase,
+  batch: MessageBatch,
+  max_batch_len: usize,
+  sink: Box<dyn FnMut(MessageBatch)>,
+}
+
+impl BatchingChannel {
+  /// Creates a channel that also flushes the queue once `max_batch_len`
+  /// messages are waiting, which bounds the memory it holds on to.
+  pub fn new(
+    max_batch_len: usize,
+    sink: impl FnMut(MessageBatch) + 'static,
+  ) -> Self {
+    Self {
+      base: ChannelBase::new::<Self>(),
+      batch: MessageBatch::default(),
+      max_batch_len: max_batch_len.max(1),
+      sink: Box::new(sink),
+    }
+  }
+
+  /// Passes the queued messages to the sink, if there are any.
+  pub fn flush(&mut self) {
+    if !self.batch.is_empty() {
+      let batch = std::mem::take(&mut self.batch);
+      (self.sink)(batch);
+    }
+  }
+}
+
+impl ChannelImpl for BatchingChannel {
+  fn base(&self) -> &ChannelBase {
+    &self.base
+  }
+  fn base_mut(&mut self) -> &mut ChannelBase {
+    &mut self.base
+  }
+  fn send_response(&mut self, call_id: i32, message: UniquePtr<StringBuffer>) {
+    self.batch.push(Some(call_id), message);
+    self.flush();
+  }
+  fn send_notification(&mut self, message: UniquePtr<StringBuffer>) {
+    self.batch.push(None, message);
+    if self.batch.len() >= self.max_batch_len {
+      self.flush();
+    }
+  }
+  fn flush_protocol_notifications(&mut self) {
+    self.flush();
+  }
+}
+
+/// Starts a thread that converts the batches of a `BatchingChannel` to
+/// UTF-8 and passes them to `f`, so that neither the encoding nor `f` run on
+/// the isolate's thread. Returns the sink to create the channel with; the
+/// thread exits once the sink is dropped and every batch is handled.
+pub fn spawn_utf8_encoder(
+  mut f: impl FnMut(Vec<(Option<i32>, string::String)>) + Send + 'static,
+) -> impl FnMut(MessageBatch) {
+  let (sender, receiver) = mpsc::channel::<MessageBatch>();
+  thread::Builder::new()
+    .name("inspector utf8 encoder".to_owned())
+    .spawn(move || {
+      for batch in receiver {
+        let messages = batch.to_utf8();
+        // V8's buffers are freed here, off the isolate's thread.
+        drop(batch);
+        f(messages);
+      }
+    })
+    .unwrap();
+  move |batch| {
+    // The thread only stops early if `f` panicked.
+    let _ = sender.send(batch);
+  }
+}
+
 #[cfg(test)]
 mod tests {
   use super::*;
@@ -398,6 +545,80 @@ mod tests {
     channel.flush_protocol_notifications();
     assert_eq!(CALL_COUNT.swap(0, SeqCst), 1);
   }
+
+  #[test]
+  fn test_batching_channel() {
+    use std::cell::RefCell;
+    use std::rc::Rc;
+
+    let batches = Rc::new(RefCell::new(Vec::new()));
+    let mut channel = BatchingChannel::new(3, {
+      let batches = batches.clone();
+      move |batch: MessageBatch| {
+        assert!(batch.iter().all(|(_, message)| message.is_8bit()));
+        batches.borrow_mut().push(batch.to_utf8())
+      }
+    });
+    let message =
+      |s: &str| StringBuffer::create(StringView::from(s.as_bytes()));
+    channel.send_notification(message("a"));
+    channel.send_notification(message("b"));
+    assert!(batches.borrow().is_empty());
+    channel.flush_protocol_notifications();
+    channel.flush_protocol_notifications();
+    channel.send_notification(message("c"));
+    channel.send_response(7, message("d"));
+    for s in &["e", "f", "g", "h"] {
+      channel.send_notification(message(s));
+    }
+    channel.flush();
+    let batches = batches.borrow();
+    let batches = batches
+      .iter()
+      .map(|batch| {
+        batch
+          .iter()
+          .map(|(call_id, message)| (*call_id, message.as_str()))
+          .collect::<Vec<_>>()
+      })
+      .collect::<Vec<_>>();
+    assert_eq!(
+      batches,
+      vec![
+        vec![(None, "a"), (None, "b")],
+        vec![(None, "c"), (Some(7), "d")],
+        vec![(None, "e"), (None, "f"), (None, "g")],
+        vec![(None, "h")],
+      ]
+    );
+  }
+
+  #[test]
+  fn test_spawn_utf8_encoder() {
+    let (sender, receiver) = mpsc::channel();
+    let mut channel = BatchingChannel::new(
+      16,
+      spawn_utf8_encoder(move |batch| sender.send(batch).unwrap()),
+    );
+    let latin1 = [b'{', 0xd8, 0xde, b'}'];
+    let utf16: [u16; 3] = [0x7b, 0x20ac, 0x7d];
+    channel
+      .send_notification(StringBuffer::create(StringView::from(&b"{}"[..])));
+    channel
+      .send_notification(StringBuffer::create(StringView::from(&latin1[..])));
+    channel
+      .send_response(1, StringBuffer::create(StringView::from(&utf16[..])));
+    assert_eq!(
+      receiver.recv().unwrap(),
+      vec![
+        (None, "{}".to_owned()),
+        (None, "{ØÞ}".to_owned()),
+        (Some(1), "{€}".to_owned()),
+      ]
+    );
+    drop(channel);
+    assert!(receiver.recv().is_err());
+  }
 }
 
 #[repr(C)]
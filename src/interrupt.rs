@@ -0,0 +1,227 @@
+// Copyright 2019-2021 the Deno authors. All rights reserved. MIT license.
+
+//! Storage for the closures passed to
+//! `IsolateHandle::request_interrupt_with()`.
+//!
+//! Every isolate preallocates a small ring of slots, in which closures of up
+//! to `INLINE_SIZE` bytes are stored without a heap allocation. The ring is
+//! a bounded lock-free queue (Dmitry Vyukov's MPMC algorithm), so any number
+//! of threads can post closures while the isolate's thread takes them out.
+
+use std::cell::UnsafeCell;
+use std::mem::align_of;
+use std::mem::size_of;
+use std::mem::ManuallyDrop;
+use std::mem::MaybeUninit;
+use std::ptr;
+use std::sync::atomic::AtomicUsize;
+use std::sync::atomic::Ordering;
+
+use crate::Isolate;
+
+/// The number of slots in an isolate's interrupt queue. Closures posted
+/// while it is full go to a list behind a mutex instead.
+pub(crate) const INTERRUPT_QUEUE_CAPACITY: usize = 32;
+
+const INLINE_WORDS: usize = 4;
+const INLINE_SIZE: usize = INLINE_WORDS * size_of::<usize>();
+
+type Storage = MaybeUninit<[usize; INLINE_WORDS]>;
+
+/// A type-erased `FnOnce(&mut Isolate) + Send`. Small closures are stored
+/// inline; larger ones are boxed.
+pub(crate) struct InterruptFn {
+  storage: Storage,
+  call: unsafe fn(*mut Storage, &mut Isolate),
+  drop: unsafe fn(*mut Storage),
+}
+
+unsafe impl Send for InterruptFn {}
+
+impl InterruptFn {
+  pub fn new<F>(f: F) -> Self
+  where
+    F: FnOnce(&mut Isolate) + Send + 'static,
+  {
+    if size_of::<F>() <= INLINE_SIZE && align_of::<F>() <= align_of::<Storage>()
+    {
+      Self::with_storage(f, call_inline::<F>, drop_inline::<F>)
+    } else {
+      Self::with_storage(Box::new(f), call_boxed::<F>, drop_inline::<Box<F>>)
+    }
+  }
+
+  fn with_storage<T>(
+    value: T,
+    call: unsafe fn(*mut Storage, &mut Isolate),
+    drop: unsafe fn(*mut Storage),
+  ) -> Self {
+    let mut storage = Storage::uninit();
+    unsafe { ptr::write(storage.as_mut_ptr() as *mut T, value) };
+    Self {
+      storage,
+      call,
+      drop,
+    }
+  }
+
+  pub fn call(self, isolate: &mut Isolate) {
+    let mut this = ManuallyDrop::new(self);
+    unsafe { (this.call)(&mut this.storage, isolate) }
+  }
+}
+
+impl Drop for InterruptFn {
+  fn drop(&mut self) {
+    unsafe { (self.drop)(&mut self.storage) }
+  }
+}
+
+unsafe fn call_inline<F: FnOnce(&mut Isolate)>(
+  storage: *mut Storage,
+  isolate: &mut Isolate,
+) {
+  ptr::read(storage as *mut F)(isolate)
+}
+
+unsafe fn call_boxed<F: FnOnce(&mut Isolate)>(
+  storage: *mut Storage,
+  isolate: &mut Isolate,
+) {
+  ptr::read(storage as *mut Box<F>)(isolate)
+}
+
+unsafe fn drop_inline<T>(storage: *mut Storage) {
+  ptr::drop_in_place(storage as *mut T)
+}
+
+pub(crate) struct InterruptQueue {
+  slots: Box<[Slot]>,
+  enqueue_pos: AtomicUsize,
+  dequeue_pos: AtomicUsize,
+}
+
+struct Slot {
+  /// Equal to the position of the next push into this slot while it is
+  /// empty, and to that position + 1 once it is full.
+  sequence: AtomicUsize,
+  value: UnsafeCell<MaybeUninit<InterruptFn>>,
+}
+
+unsafe impl Sync for InterruptQueue {}
+
+impl InterruptQueue {
+  pub fn new() -> Self {
+    let capacity = INTERRUPT_QUEUE_CAPACITY;
+    debug_assert!(capacity.is_power_of_two());
+    let slots = (0..capacity)
+      .map(|i| Slot {
+        sequence: AtomicUsize::new(i),
+        value: UnsafeCell::new(MaybeUninit::uninit()),
+      })
+      .collect();
+    Self {
+      slots,
+      enqueue_pos: AtomicUsize::new(0),
+      dequeue_pos: AtomicUsize::new(0),
+    }
+  }
+
+  /// Returns the closure back if the queue is full.
+  pub fn push(&self, f: InterruptFn) -> Result<(), InterruptFn> {
+    let mask = self.slots.len() - 1;
+    let mut pos = self.enqueue_pos.load(Ordering::Relaxed);
+    loop {
+      let slot = &self.slots[pos & mask];
+      let sequence = slot.sequence.load(Ordering::Acquire);
+      let diff = sequence.wrapping_sub(pos) as isize;
+      if diff == 0 {
+        match self.enqueue_pos.compare_exchange_weak(
+          pos,
+          pos.wrapping_add(1),
+          Ordering::Relaxed,
+          Ordering::Relaxed,
+        ) {
+          Ok(_) => {
+            unsafe { (*slot.value.get()).as_mut_ptr().write(f) };
+            slot.sequence.store(pos.wrapping_add(1), Ordering::Release);
+            return Ok(());
+          }
+          Err(current) => pos = current,
+        }
+      } else if diff < 0 {
+        return Err(f);
+      } else {
+        pos = self.enqueue_pos.load(Ordering::Relaxed);
+      }
+    }
+  }
+
+  pub fn pop(&self) -> Option<InterruptFn> {
+    let mask = self.slots.len() - 1;
+    let mut pos = self.dequeue_pos.load(Ordering::Relaxed);
+    loop {
+      let slot = &self.slots[pos & mask];
+      let sequence = slot.sequence.load(Ordering::Acquire);
+      let diff = sequence.wrapping_sub(pos.wrapping_add(1)) as isize;
+      if diff == 0 {
+        match self.dequeue_pos.compare_exchange_weak(
+          pos,
+          pos.wrapping_add(1),
+          Ordering::Relaxed,
+          Ordering::Relaxed,
+        ) {
+          Ok(_) => {
+            let f = unsafe { (*slot.value.get()).as_ptr().read() };
+            slot
+              .sequence
+              .store(pos.wrapping_add(self.slots.len()), Ordering::Release);
+            return Some(f);
+          }
+          Err(current) => pos = current,
+        }
+      } else if diff < 0 {
+        return None;
+      } else {
+        pos = self.dequeue_pos.load(Ordering::Relaxed);
+      }
+    }
+  }
+}
+
+impl Drop for InterruptQueue {
+  fn drop(&mut self) {
+    // Closures that were posted after the isolate's last interrupt ran.
+    while self.pop().is_some() {}
+  }
+}
+
+#[cfg(test)]
+mod tests {
+  use super::*;
+  use std::sync::Arc;
+
+  #[test]
+  fn test_interrupt_queue() {
+    let queue = InterruptQueue::new();
+    assert!(queue.pop().is_none());
+    let counter = Arc::new(AtomicUsize::new(0));
+    for _ in 0..INTERRUPT_QUEUE_CAPACITY {
+      let counter = counter.clone();
+      let f = InterruptFn::new(move |_| drop(counter));
+      assert!(queue.push(f).is_ok());
+    }
+    let f = InterruptFn::new(|_| {});
+    assert!(queue.push(f).is_err());
+    assert_eq!(Arc::strong_count(&counter), INTERRUPT_QUEUE_CAPACITY + 1);
+    // Popped closures that aren't called are dropped.
+    drop(queue.pop().unwrap());
+    assert_eq!(Arc::strong_count(&counter), INTERRUPT_QUEUE_CAPACITY);
+    let big = [counter.clone(), counter.clone(), counter.clone()];
+    let big = (big, [0u64; 8]);
+    assert!(queue.push(InterruptFn::new(move |_| drop(big))).is_ok());
+    assert_eq!(Arc::strong_count(&counter), INTERRUPT_QUEUE_CAPACITY + 3);
+    drop(queue);
+    assert_eq!(Arc::strong_count(&counter), 1);
+  }
+}
@@ -1,9 +1,20 @@
 // Copyright 2019-2021 the Deno authors. All rights reserved. MIT license.
+use crate::coverage::Coverage;
+use crate::coverage::CoverageMode;
+use crate::coverage::RawCoverage;
 use crate::function::FunctionCallbackInfo;
+use crate::heap_profiler::AllocationProfile;
+use crate::heap_profiler::RawAllocationProfile;
+use crate::heap_snapshot::HeapSnapshotCompression;
+use crate::heap_snapshot::HeapSnapshotProgress;
+use crate::heap_snapshot::HeapSnapshotWriteOptions;
+use crate::interrupt::InterruptFn;
+use crate::interrupt::InterruptQueue;
 use crate::isolate_create_params::raw;
 use crate::isolate_create_params::CreateParams;
 use crate::promise::PromiseRejectMessage;
 use crate::scope::data::ScopeData;
+use crate::support::int;
 use crate::support::BuildTypeIdHasher;
 use crate::support::MapFnFrom;
 use crate::support::MapFnTo;
@@ -24,23 +35,39 @@ use crate::Module;
 use crate::Object;
 use crate::Promise;
 use crate::ScriptOrModule;
+use crate::SharedArrayBuffer;
 use crate::String;
 use crate::Value;
 
 use std::any::Any;
 use std::any::TypeId;
 
+use std::cmp::Reverse;
+use std::collections::BinaryHeap;
 use std::collections::HashMap;
+use std::collections::VecDeque;
 use std::ffi::c_void;
 use std::fmt::{self, Debug, Formatter};
+use std::io;
+use std::io::Write;
+use std::marker::PhantomData;
 use std::mem::MaybeUninit;
 use std::ops::Deref;
 use std::ops::DerefMut;
 use std::os::raw::c_char;
+use std::path::Path;
 use std::ptr::null_mut;
 use std::ptr::NonNull;
+use std::sync::atomic::AtomicBool;
+use std::sync::atomic::AtomicPtr;
+use std::sync::atomic::AtomicUsize;
+use std::sync::atomic::Ordering;
 use std::sync::Arc;
+use std::sync::Condvar;
 use std::sync::Mutex;
+use std::thread;
+use std::time::Duration;
+use std::time::Instant;
 
 /// Policy for running microtasks:
 ///   - explicit: microtasks are invoked with the
@@ -134,6 +161,64 @@ pub type NearHeapLimitCallback = extern "C" fn(
 pub type OomErrorCallback =
   extern "C" fn(location: *const c_char, is_heap_oom: bool);
 
+/// The events reported to an `AtomicsWaitCallback`.
+#[repr(C)]
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum AtomicsWaitEvent {
+  /// Indicates that this call is happening before waiting. It is reported
+  /// before the value is compared, so every wait reports it, followed by
+  /// exactly one of the other events.
+  StartWait,
+  /// `Atomics.wait()` finished because of an `Atomics.wake()` call.
+  WokenUp,
+  /// `Atomics.wait()` finished because it timed out.
+  TimedOut,
+  /// `Atomics.wait()` was interrupted through `terminate_execution()`.
+  TerminatedExecution,
+  /// `Atomics.wait()` was stopped through `AtomicsWaitWakeHandle::wake()`.
+  APIStopped,
+  /// `Atomics.wait()` returned right after `StartWait` without blocking, as
+  /// the value was not the expected one.
+  NotEqual,
+}
+
+/// Passed to an `AtomicsWaitCallback` with `AtomicsWaitEvent::StartWait`, to
+/// stop the wait from another thread. It is passed for every wait, including
+/// one that ends at once with `AtomicsWaitEvent::NotEqual`.
+#[repr(C)]
+#[derive(Debug)]
+pub struct AtomicsWaitWakeHandle(Opaque);
+
+impl AtomicsWaitWakeHandle {
+  /// Stops the wait that this handle was passed for. The callback is then
+  /// called again, with `AtomicsWaitEvent::APIStopped`.
+  ///
+  /// This can be called from any thread, but only until the callback is
+  /// called with the event that ends the wait; the handle is invalid after
+  /// that.
+  pub fn wake(&self) {
+    unsafe { v8__Isolate__AtomicsWaitWakeHandle__Wake(self) }
+  }
+}
+
+/// Called when `Atomics.wait()` starts, before the value is compared, and
+/// again when it is done, on the isolate's thread. `array_buffer` and
+/// `offset_in_bytes` are the location that is waited on, `value` is the value
+/// it is expected to have, and `timeout_in_ms` is the timeout, which is
+/// infinite if there is none.
+///
+/// `wake_handle` is only non-null for `AtomicsWaitEvent::StartWait`. The
+/// callback must not call into JavaScript.
+pub type AtomicsWaitCallback = extern "C" fn(
+  event: AtomicsWaitEvent,
+  array_buffer: Local<SharedArrayBuffer>,
+  offset_in_bytes: usize,
+  value: i64,
+  timeout_in_ms: f64,
+  wake_handle: *mut AtomicsWaitWakeHandle,
+  data: *mut c_void,
+);
+
 /// Collection of V8 heap information.
 ///
 /// Instances of this class can be passed to v8::Isolate::GetHeapStatistics to
@@ -232,6 +317,14 @@ extern "C" {
     function: *const Function,
   );
   fn v8__Isolate__SetAllowAtomicsWait(isolate: *mut Isolate, allow: bool);
+  fn v8__Isolate__SetAtomicsWaitCallback(
+    isolate: *mut Isolate,
+    callback: Option<AtomicsWaitCallback>,
+    data: *mut c_void,
+  );
+  fn v8__Isolate__AtomicsWaitWakeHandle__Wake(
+    this: *const AtomicsWaitWakeHandle,
+  );
   fn v8__Isolate__SetWasmStreamingCallback(
     isolate: *mut Isolate,
     callback: extern "C" fn(*const FunctionCallbackInfo),
@@ -241,8 +334,23 @@ extern "C" {
   fn v8__HeapProfiler__TakeHeapSnapshot(
     isolate: *mut Isolate,
     callback: extern "C" fn(*mut c_void, *const u8, usize) -> bool,
+    progress_callback: Option<extern "C" fn(*mut c_void, int, int) -> bool>,
     arg: *mut c_void,
   );
+  fn v8__HeapProfiler__StartSamplingHeapProfiler(
+    isolate: *mut Isolate,
+    sample_interval: u64,
+    stack_depth: int,
+    force_gc: bool,
+  ) -> bool;
+  fn v8__HeapProfiler__StopSamplingHeapProfiler(isolate: *mut Isolate);
+  fn v8__HeapProfiler__GetAllocationProfile(
+    isolate: *mut Isolate,
+  ) -> *mut RawAllocationProfile;
+  fn v8__Coverage__SelectMode(isolate: *mut Isolate, mode: CoverageMode);
+  fn v8__Coverage__CollectPrecise(isolate: *mut Isolate) -> *mut RawCoverage;
+  fn v8__Coverage__CollectBestEffort(isolate: *mut Isolate)
+    -> *mut RawCoverage;
 
   fn v8__HeapStatistics__CONSTRUCT(s: *mut MaybeUninit<HeapStatistics>);
   fn v8__HeapStatistics__total_heap_size(s: *const HeapStatistics) -> usize;
@@ -339,6 +447,45 @@ impl Isolate {
     self.thread_safe_handle().is_execution_terminating()
   }
 
+  /// Runs the closures queued with `IsolateHandle::request_interrupt_with()`
+  /// right away, rather than the next time that JavaScript code services an
+  /// interrupt. Closures queued while they run are run too. Returns the
+  /// number of closures that were run.
+  pub fn run_queued_interrupts(&mut self) -> usize {
+    let mut count = 0;
+    loop {
+      let annex = self.get_annex();
+      let f = match annex.interrupts.pop() {
+        Some(f) => f,
+        None => match annex.interrupt_overflow.lock().unwrap().pop_front() {
+          Some(f) => f,
+          None => return count,
+        },
+      };
+      f.call(self);
+      count += 1;
+    }
+  }
+
+  /// Starts enforcing a CPU time budget on the work that this thread runs
+  /// in the isolate, until the returned guard is dropped. Execution is
+  /// terminated when the budget is exceeded. All isolates share a single
+  /// watchdog thread, so this is cheap enough to do for every request.
+  ///
+  /// CPU time is read from the thread's CPU clock where there is one (on
+  /// Unix), so time spent waiting for I/O or for other threads to be
+  /// scheduled doesn't count. It is checked with `request_interrupt()`,
+  /// which is only serviced while JavaScript is running: set
+  /// `CpuBudget::wall_limit` to bound native callbacks too.
+  pub fn start_cpu_budget(&self, budget: CpuBudget) -> CpuBudgetGuard {
+    CpuBudgetGuard {
+      start_time: Instant::now(),
+      start_cpu_time: thread_cpu_time(),
+      id: CPU_WATCHDOG.start(self, budget),
+      _not_send: PhantomData,
+    }
+  }
+
   pub(crate) fn create_annex(
     &mut self,
     create_param_allocations: Box<dyn Any>,
@@ -641,6 +788,21 @@ impl Isolate {
     unsafe { v8__Isolate__SetAllowAtomicsWait(self, allow) }
   }
 
+  /// Sets a callback that is notified when `Atomics.wait()` starts and stops
+  /// blocking this isolate's thread, so that an embedder's scheduler can
+  /// account for blocked isolates and wake them up; `None` removes it. Only
+  /// one callback can be set. `data` is passed to it unchanged.
+  ///
+  /// `terminate_execution()` also ends blocked waits, which are then
+  /// reported with `AtomicsWaitEvent::TerminatedExecution`.
+  pub fn set_atomics_wait_callback(
+    &mut self,
+    callback: Option<AtomicsWaitCallback>,
+    data: *mut c_void,
+  ) {
+    unsafe { v8__Isolate__SetAtomicsWaitCallback(self, callback, data) }
+  }
+
   /// Embedder injection point for `WebAssembly.compileStreaming(source)`.
   /// The expectation is that the embedder sets it at most once.
   ///
@@ -672,10 +834,15 @@ impl Isolate {
     // IsolateHandle that outlives the isolate will know that it can't call
     // methods on the isolate.
     let annex = self.get_annex_mut();
-    {
-      let _lock = annex.isolate_mutex.lock().unwrap();
-      annex.isolate = null_mut();
+    annex
+      .users
+      .fetch_or(IsolateAnnex::DISPOSED, Ordering::AcqRel);
+    while annex.users.load(Ordering::Acquire) != IsolateAnnex::DISPOSED {
+      // Other threads only use the isolate for the duration of a single
+      // V8 API call.
+      thread::yield_now();
     }
+    annex.isolate.store(null_mut(), Ordering::Relaxed);
 
     // Clear slots and drop owned objects that were taken out of `CreateParams`.
     annex.create_param_allocations = Box::new(());
@@ -715,22 +882,215 @@ impl Isolate {
     }
 
     let arg = &mut callback as *mut F as *mut c_void;
-    unsafe { v8__HeapProfiler__TakeHeapSnapshot(self, trampoline::<F>, arg) }
+    unsafe {
+      v8__HeapProfiler__TakeHeapSnapshot(self, trampoline::<F>, None, arg)
+    }
+  }
+
+  /// Like `take_heap_snapshot()`, but `progress` is called with the number
+  /// of steps done and the total number of steps while the snapshot is being
+  /// built, before it is serialized. Returning false from either callback
+  /// aborts the snapshot.
+  pub fn take_heap_snapshot_with_progress<F, P>(
+    &mut self,
+    callback: F,
+    progress: P,
+  ) where
+    F: FnMut(&[u8]) -> bool,
+    P: FnMut(u32, u32) -> bool,
+  {
+    extern "C" fn trampoline<F, P>(
+      arg: *mut c_void,
+      data: *const u8,
+      size: usize,
+    ) -> bool
+    where
+      F: FnMut(&[u8]) -> bool,
+    {
+      let (callback, _) = unsafe { &mut *(arg as *mut (F, P)) };
+      let slice = unsafe { std::slice::from_raw_parts(data, size) };
+      callback(slice)
+    }
+
+    extern "C" fn progress_trampoline<F, P>(
+      arg: *mut c_void,
+      done: int,
+      total: int,
+    ) -> bool
+    where
+      P: FnMut(u32, u32) -> bool,
+    {
+      let (_, progress) = unsafe { &mut *(arg as *mut (F, P)) };
+      progress(done as u32, total as u32)
+    }
+
+    let mut callbacks = (callback, progress);
+    let arg = &mut callbacks as *mut (F, P) as *mut c_void;
+    unsafe {
+      v8__HeapProfiler__TakeHeapSnapshot(
+        self,
+        trampoline::<F, P>,
+        Some(progress_trampoline::<F, P>),
+        arg,
+      )
+    }
+  }
+
+  /// Takes a heap snapshot and streams it to `writer`, which is returned
+  /// once the whole snapshot has been written and flushed. The snapshot is
+  /// handed to a background thread that writes it, through a bounded number
+  /// of buffers: if the writer can't keep up, taking the snapshot is paused
+  /// rather than buffering more of it in memory. See
+  /// `HeapSnapshotWriteOptions`.
+  ///
+  /// Since `writer` runs on that thread, so does any compression it does,
+  /// e.g. with `flate2::write::GzEncoder`:
+  ///
+  /// ```ignore
+  /// let file = std::fs::File::create("app.heapsnapshot.gz")?;
+  /// let encoder = GzEncoder::new(file, flate2::Compression::fast());
+  /// let encoder =
+  ///   isolate.write_heap_snapshot(encoder, &Default::default(), |_| true)?;
+  /// encoder.finish()?;
+  /// ```
+  ///
+  /// `write_heap_snapshot_to_file()` does this for files.
+  ///
+  /// `progress` is called on this thread, first while the snapshot is being
+  /// built and then every time a buffer is handed to the writer thread.
+  /// Returning false aborts the snapshot and returns an error of kind
+  /// `Interrupted`; whatever was written so far is left to the caller.
+  pub fn write_heap_snapshot<W: Write + Send + 'static>(
+    &mut self,
+    writer: W,
+    options: &HeapSnapshotWriteOptions,
+    progress: impl FnMut(HeapSnapshotProgress) -> bool,
+  ) -> io::Result<W> {
+    crate::heap_snapshot::write_heap_snapshot(self, writer, options, progress)
+  }
+
+  /// Like `write_heap_snapshot()`, but writes the snapshot to a new file at
+  /// `path`, compressed on the writer thread as it is streamed (gzip needs
+  /// the `gzip` feature). Returns the size of the file. The `bytes_out` of
+  /// `HeapSnapshotProgress::Writing` is the number of compressed bytes
+  /// written to the file so far. If the snapshot fails or is aborted, the
+  /// partial file is left in place.
+  pub fn write_heap_snapshot_to_file(
+    &mut self,
+    path: impl AsRef<Path>,
+    compression: HeapSnapshotCompression,
+    options: &HeapSnapshotWriteOptions,
+    progress: impl FnMut(HeapSnapshotProgress) -> bool,
+  ) -> io::Result<u64> {
+    crate::heap_snapshot::write_heap_snapshot_to_file(
+      self,
+      path.as_ref(),
+      compression,
+      options,
+      progress,
+    )
+  }
+
+  /// Starts the sampling heap profiler, which records the JavaScript stack
+  /// of a random sample of allocations: on average one every
+  /// `sample_interval` bytes. Only the `stack_depth` innermost frames of
+  /// each stack are kept. Unlike a heap snapshot, this is cheap enough to be
+  /// left enabled in production. If `force_gc` is true, a garbage collection
+  /// is performed before each call to `get_allocation_profile()`, so that
+  /// the profile doesn't contain dead objects.
+  ///
+  /// Returns false if the profiler was already started.
+  pub fn start_sampling_heap_profiler(
+    &mut self,
+    sample_interval: u64,
+    stack_depth: i32,
+    force_gc: bool,
+  ) -> bool {
+    unsafe {
+      v8__HeapProfiler__StartSamplingHeapProfiler(
+        self,
+        sample_interval,
+        stack_depth,
+        force_gc,
+      )
+    }
+  }
+
+  /// Stops the sampling heap profiler and discards its samples.
+  pub fn stop_sampling_heap_profiler(&mut self) {
+    unsafe { v8__HeapProfiler__StopSamplingHeapProfiler(self) }
+  }
+
+  /// Returns the sampled objects that are still alive, grouped by the stack
+  /// that allocated them, or None if the sampling heap profiler isn't
+  /// running. The profiler keeps running.
+  pub fn get_allocation_profile(&mut self) -> Option<AllocationProfile> {
+    // The profile's strings are allocated as local handles.
+    let scope = &mut HandleScope::new(self);
+    let isolate: &mut Isolate = scope;
+    let raw = unsafe { v8__HeapProfiler__GetAllocationProfile(isolate) };
+    if raw.is_null() {
+      return None;
+    }
+    Some(unsafe { AllocationProfile::from_raw(scope, raw) })
+  }
+
+  /// Selects how code coverage is collected. Switching to a precise mode
+  /// makes V8 keep the invocation counts of every function, which costs
+  /// some memory and disables a few optimizations; the block modes also make
+  /// V8 recompile functions with counters for their blocks. Functions that
+  /// were compiled lazily and garbage collected before the switch are not
+  /// reported, so switch before running the code to be measured.
+  pub fn select_coverage_mode(&mut self, mode: CoverageMode) {
+    unsafe { v8__Coverage__SelectMode(self, mode) }
+  }
+
+  /// Collects precise coverage, and resets the counts in the count modes.
+  /// This doesn't go through the inspector's JSON protocol. Returns None if
+  /// the coverage mode is `CoverageMode::BestEffort`.
+  pub fn take_precise_coverage(&mut self) -> Option<Coverage> {
+    // Function and script names are allocated as local handles.
+    let scope = &mut HandleScope::new(self);
+    let isolate: &mut Isolate = scope;
+    let raw = unsafe { v8__Coverage__CollectPrecise(isolate) };
+    if raw.is_null() {
+      return None;
+    }
+    Some(unsafe { Coverage::from_raw(scope, raw) })
+  }
+
+  /// Collects best-effort coverage, whatever the coverage mode. The counts
+  /// are not reset.
+  pub fn take_best_effort_coverage(&mut self) -> Coverage {
+    let scope = &mut HandleScope::new(self);
+    let isolate: &mut Isolate = scope;
+    let raw = unsafe { v8__Coverage__CollectBestEffort(isolate) };
+    unsafe { Coverage::from_raw(scope, raw) }
   }
 }
 
 pub(crate) struct IsolateAnnex {
   create_param_allocations: Box<dyn Any>,
   slots: HashMap<TypeId, Box<dyn Any>, BuildTypeIdHasher>,
-  // The `isolate` and `isolate_mutex` fields are there so an `IsolateHandle`
-  // (which may outlive the isolate itself) can determine whether the isolate
-  // is still alive, and if so, get a reference to it. Safety rules:
-  // - The 'main thread' must lock the mutex and reset `isolate` to null just
-  //   before the isolate is disposed.
-  // - Any other thread must lock the mutex while it's reading/using the
-  //   `isolate` pointer.
-  isolate: *mut Isolate,
-  isolate_mutex: Mutex<()>,
+  // The `isolate` and `users` fields are there so an `IsolateHandle` (which
+  // may outlive the isolate itself) can determine whether the isolate is
+  // still alive, and if so, get a reference to it, without taking a lock.
+  // `users` counts the threads using the `isolate` pointer, in units of
+  // `ONE_USER`, and has the `DISPOSED` bit set once the isolate is going
+  // away. Safety rules:
+  // - Any other thread must add itself to `users` while it's reading/using
+  //   the `isolate` pointer, and must not do so once `DISPOSED` is set (see
+  //   `IsolateHandle::with_isolate()`).
+  // - The 'main thread' must set `DISPOSED`, wait for the other users to
+  //   leave, and reset `isolate` to null just before the isolate is disposed.
+  isolate: AtomicPtr<Isolate>,
+  users: AtomicUsize,
+  // The closures of `IsolateHandle::request_interrupt_with()`. Those that
+  // don't fit in `interrupts` go to `interrupt_overflow`.
+  interrupts: InterruptQueue,
+  interrupt_overflow: Mutex<VecDeque<InterruptFn>>,
+  // Whether a V8 interrupt that will run the queued closures is pending.
+  interrupt_requested: AtomicBool,
 }
 
 impl IsolateAnnex {
@@ -741,17 +1101,23 @@ impl IsolateAnnex {
     Self {
       create_param_allocations,
       slots: HashMap::default(),
-      isolate,
-      isolate_mutex: Mutex::new(()),
+      isolate: AtomicPtr::new(isolate),
+      users: AtomicUsize::new(0),
+      interrupts: InterruptQueue::new(),
+      interrupt_overflow: Mutex::new(VecDeque::new()),
+      interrupt_requested: AtomicBool::new(false),
     }
   }
+
+  const DISPOSED: usize = 1;
+  const ONE_USER: usize = 2;
 }
 
 impl Debug for IsolateAnnex {
   fn fmt(&self, f: &mut Formatter<'_>) -> fmt::Result {
     f.debug_struct("IsolateAnnex")
       .field("isolate", &self.isolate)
-      .field("isolate_mutex", &self.isolate_mutex)
+      .field("users", &self.users)
       .finish()
   }
 }
@@ -769,11 +1135,43 @@ unsafe impl Send for IsolateHandle {}
 unsafe impl Sync for IsolateHandle {}
 
 impl IsolateHandle {
-  // This function is marked unsafe because it must be called only with either
-  // IsolateAnnex::mutex locked, or from the main thread associated with the V8
-  // isolate.
+  // This function is marked unsafe because it must be called only from
+  // `with_isolate()`, or from the main thread associated with the V8 isolate.
   pub(crate) unsafe fn get_isolate_ptr(&self) -> *mut Isolate {
-    self.0.isolate
+    self.0.isolate.load(Ordering::Relaxed)
+  }
+
+  /// Calls `f` with the isolate, unless it was already destroyed. Instead of
+  /// a lock, this takes two atomic read-modify-write operations, so handles
+  /// can be polled from any number of threads without contending with each
+  /// other or with the isolate's thread. The isolate's disposal waits for
+  /// `f` to return.
+  fn with_isolate<R>(&self, f: impl FnOnce(*mut Isolate) -> R) -> Option<R> {
+    let annex = &self.0;
+    // Read-modify-write operations on `users` are totally ordered: either
+    // disposal sees this thread's user count and waits for it, or this
+    // thread sees the `DISPOSED` bit. Once it is set, no user is added, so
+    // handles that keep calling this can't hold up disposal.
+    let mut users = annex.users.load(Ordering::Relaxed);
+    loop {
+      if users & IsolateAnnex::DISPOSED != 0 {
+        return None;
+      }
+      match annex.users.compare_exchange_weak(
+        users,
+        users + IsolateAnnex::ONE_USER,
+        Ordering::Acquire,
+        Ordering::Relaxed,
+      ) {
+        Ok(_) => break,
+        Err(current) => users = current,
+      }
+    }
+    let result = f(annex.isolate.load(Ordering::Relaxed));
+    annex
+      .users
+      .fetch_sub(IsolateAnnex::ONE_USER, Ordering::Release);
+    Some(result)
   }
 
   fn new(isolate: &Isolate) -> Self {
@@ -788,13 +1186,11 @@ impl IsolateHandle {
   ///
   /// Returns false if Isolate was already destroyed.
   pub fn terminate_execution(&self) -> bool {
-    let _lock = self.0.isolate_mutex.lock().unwrap();
-    if self.0.isolate.is_null() {
-      false
-    } else {
-      unsafe { v8__Isolate__TerminateExecution(self.0.isolate) };
-      true
-    }
+    self
+      .with_isolate(|isolate| unsafe {
+        v8__Isolate__TerminateExecution(isolate)
+      })
+      .is_some()
   }
 
   /// Resume execution capability in the given isolate, whose execution
@@ -812,13 +1208,11 @@ impl IsolateHandle {
   ///
   /// Returns false if Isolate was already destroyed.
   pub fn cancel_terminate_execution(&self) -> bool {
-    let _lock = self.0.isolate_mutex.lock().unwrap();
-    if self.0.isolate.is_null() {
-      false
-    } else {
-      unsafe { v8__Isolate__CancelTerminateExecution(self.0.isolate) };
-      true
-    }
+    self
+      .with_isolate(|isolate| unsafe {
+        v8__Isolate__CancelTerminateExecution(isolate)
+      })
+      .is_some()
   }
 
   /// Is V8 terminating JavaScript execution.
@@ -830,12 +1224,11 @@ impl IsolateHandle {
   ///
   /// Returns false if Isolate was already destroyed.
   pub fn is_execution_terminating(&self) -> bool {
-    let _lock = self.0.isolate_mutex.lock().unwrap();
-    if self.0.isolate.is_null() {
-      false
-    } else {
-      unsafe { v8__Isolate__IsExecutionTerminating(self.0.isolate) }
-    }
+    self
+      .with_isolate(|isolate| unsafe {
+        v8__Isolate__IsExecutionTerminating(isolate)
+      })
+      .unwrap_or(false)
   }
 
   /// Request V8 to interrupt long running JavaScript code and invoke
@@ -854,14 +1247,297 @@ impl IsolateHandle {
     callback: InterruptCallback,
     data: *mut c_void,
   ) -> bool {
-    let _lock = self.0.isolate_mutex.lock().unwrap();
-    if self.0.isolate.is_null() {
-      false
-    } else {
-      unsafe { v8__Isolate__RequestInterrupt(self.0.isolate, callback, data) };
-      true
+    self
+      .with_isolate(|isolate| unsafe {
+        v8__Isolate__RequestInterrupt(isolate, callback, data)
+      })
+      .is_some()
+  }
+
+  /// Like `request_interrupt()`, but takes a closure, which is called on
+  /// the isolate's thread the next time it services interrupts.
+  ///
+  /// Closures are queued per isolate, and all the closures queued by the
+  /// time the isolate services an interrupt run together: however many
+  /// threads post closures, the isolate's thread only stops once for them.
+  /// They run in the order in which they were queued, except that those
+  /// queued while many were pending may run after later ones. The queue is
+  /// preallocated; a closure only needs a heap allocation when it captures
+  /// more than a few words, or when many are pending at once.
+  ///
+  /// When it is run by an interrupt, `f` must not reenter the isolate, e.g.
+  /// by calling into JavaScript.
+  ///
+  /// V8 only services interrupts while JavaScript is running. An embedder
+  /// that runs an event loop should also call
+  /// `Isolate::run_queued_interrupts()` between tasks.
+  ///
+  /// Returns false, and drops `f`, if the Isolate was already destroyed.
+  pub fn request_interrupt_with<F>(&self, f: F) -> bool
+  where
+    F: FnOnce(&mut Isolate) + Send + 'static,
+  {
+    extern "C" fn run_interrupts(isolate: &mut Isolate, _data: *mut c_void) {
+      // Every writer queues its closure before it swaps the flag, and the
+      // swap here reads the last of those swaps, so it synchronizes with it:
+      // the closures of all writers that found or set the flag before this
+      // point are visible below. A writer whose swap comes after this one
+      // finds the flag cleared and requests another interrupt for its
+      // closure, which may or may not also be run by this one.
+      let annex = isolate.get_annex();
+      annex.interrupt_requested.swap(false, Ordering::AcqRel);
+      isolate.run_queued_interrupts();
     }
+
+    let annex = &self.0;
+    let f = InterruptFn::new(f);
+    self
+      .with_isolate(|isolate| {
+        if let Err(f) = annex.interrupts.push(f) {
+          annex.interrupt_overflow.lock().unwrap().push_back(f);
+        }
+        if !annex.interrupt_requested.swap(true, Ordering::SeqCst) {
+          unsafe {
+            v8__Isolate__RequestInterrupt(isolate, run_interrupts, null_mut())
+          }
+        }
+      })
+      .is_some()
+  }
+}
+
+/// Limits on the resources that an isolate may use while running a piece of
+/// work, such as a request. See `Isolate::start_cpu_budget()`.
+#[derive(Debug, Clone, Copy)]
+pub struct CpuBudget {
+  /// The CPU time that the isolate's thread may use. Execution is
+  /// terminated once it has been used up.
+  pub cpu_limit: Duration,
+  /// The wall-clock time after which execution is terminated, however much
+  /// CPU time was used. Unlike `cpu_limit`, this is also enforced while the
+  /// isolate is in a long-running native callback, which doesn't service
+  /// interrupts.
+  pub wall_limit: Option<Duration>,
+}
+
+/// How much of a `CpuBudget` was used, as returned by `CpuBudgetGuard`.
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct CpuBudgetUsage {
+  /// The CPU time used by the isolate's thread since the budget started.
+  pub cpu_time: Duration,
+  pub wall_time: Duration,
+  /// Whether execution was terminated because a limit was exceeded. If so,
+  /// the isolate may still be terminating: call
+  /// `Isolate::cancel_terminate_execution()` before running more code.
+  pub exceeded: bool,
+}
+
+/// Enforces a `CpuBudget` until it is dropped or finished. It must be
+/// dropped on the thread that started it, whose CPU time it measures.
+#[must_use]
+#[derive(Debug)]
+pub struct CpuBudgetGuard {
+  id: u64,
+  start_cpu_time: Duration,
+  start_time: Instant,
+  _not_send: PhantomData<*const ()>,
+}
+
+impl CpuBudgetGuard {
+  pub fn usage(&self) -> CpuBudgetUsage {
+    let state = CPU_WATCHDOG.state.lock().unwrap();
+    CpuBudgetUsage {
+      cpu_time: thread_cpu_time().saturating_sub(self.start_cpu_time),
+      wall_time: self.start_time.elapsed(),
+      exceeded: state.budgets.get(&self.id).map_or(false, |b| b.exceeded),
+    }
+  }
+
+  /// Stops enforcing the budget and returns how much of it was used.
+  pub fn finish(self) -> CpuBudgetUsage {
+    self.usage()
+  }
+}
+
+impl Drop for CpuBudgetGuard {
+  fn drop(&mut self) {
+    // The budget's entries in the deadline heap become stale, and any
+    // pending interrupt finds nothing to check.
+    let mut state = CPU_WATCHDOG.state.lock().unwrap();
+    state.budgets.remove(&self.id);
+  }
+}
+
+/// Enforces the CPU budgets of all isolates from a single thread, which is
+/// started the first time a budget is.
+///
+/// A thread can't use more CPU time than wall-clock time, so the watchdog
+/// sleeps until the earliest time at which a budget could have been used
+/// up. It then asks the isolate with `request_interrupt()` to read its own
+/// thread's CPU clock, which it can do cheaply and on every platform. The
+/// interrupt terminates execution if the budget is spent, and otherwise
+/// schedules the next check for when the remainder could be.
+struct CpuWatchdog {
+  state: Mutex<CpuWatchdogState>,
+  condvar: Condvar,
+}
+
+#[derive(Default)]
+struct CpuWatchdogState {
+  thread_started: bool,
+  next_id: u64,
+  budgets: HashMap<u64, WatchedBudget>,
+  /// Entries whose time doesn't match their budget's `deadline` anymore, or
+  /// whose budget is gone, are stale and skipped.
+  deadlines: BinaryHeap<Reverse<(Instant, u64)>>,
+}
+
+struct WatchedBudget {
+  handle: IsolateHandle,
+  cpu_limit: Duration,
+  start_cpu_time: Duration,
+  wall_deadline: Option<Instant>,
+  /// When the watchdog acts on this budget next: it terminates execution if
+  /// this is the wall deadline, and requests a CPU time check otherwise.
+  deadline: Instant,
+  check_pending: bool,
+  exceeded: bool,
+}
+
+lazy_static! {
+  static ref CPU_WATCHDOG: CpuWatchdog = CpuWatchdog {
+    state: Mutex::new(Default::default()),
+    condvar: Condvar::new(),
+  };
+}
+
+impl CpuWatchdog {
+  fn start(&'static self, isolate: &Isolate, budget: CpuBudget) -> u64 {
+    let now = Instant::now();
+    let mut state = self.state.lock().unwrap();
+    if !state.thread_started {
+      thread::Builder::new()
+        .name("cpu watchdog".to_owned())
+        .spawn(move || self.run())
+        .unwrap();
+      state.thread_started = true;
+    }
+    let id = state.next_id;
+    state.next_id += 1;
+    let wall_deadline = budget.wall_limit.map(|limit| now + limit);
+    let deadline = earliest(now + budget.cpu_limit, wall_deadline);
+    state.budgets.insert(
+      id,
+      WatchedBudget {
+        handle: isolate.thread_safe_handle(),
+        cpu_limit: budget.cpu_limit,
+        start_cpu_time: thread_cpu_time(),
+        wall_deadline,
+        deadline,
+        check_pending: false,
+        exceeded: false,
+      },
+    );
+    state.deadlines.push(Reverse((deadline, id)));
+    self.condvar.notify_one();
+    id
+  }
+
+  fn run(&self) {
+    let mut state = self.state.lock().unwrap();
+    loop {
+      let now = Instant::now();
+      let (deadline, id) = match state.deadlines.peek() {
+        None => {
+          state = self.condvar.wait(state).unwrap();
+          continue;
+        }
+        Some(&Reverse(entry)) => entry,
+      };
+      if deadline > now {
+        state = self.condvar.wait_timeout(state, deadline - now).unwrap().0;
+        continue;
+      }
+      let CpuWatchdogState {
+        budgets, deadlines, ..
+      } = &mut *state;
+      deadlines.pop();
+      let budget = match budgets.get_mut(&id) {
+        Some(budget) if budget.deadline == deadline && !budget.exceeded => {
+          budget
+        }
+        _ => continue,
+      };
+      if budget.wall_deadline == Some(deadline) {
+        budget.exceeded = true;
+        budget.handle.terminate_execution();
+      } else if !budget.check_pending {
+        // `check_cpu_budget()` schedules the next check, but the interrupt
+        // won't run if the isolate is stuck in a native call.
+        budget.check_pending = true;
+        if let Some(wall_deadline) = budget.wall_deadline {
+          budget.deadline = wall_deadline;
+          deadlines.push(Reverse((wall_deadline, id)));
+        }
+        budget
+          .handle
+          .request_interrupt(check_cpu_budget, id as usize as *mut c_void);
+      }
+    }
+  }
+}
+
+extern "C" fn check_cpu_budget(isolate: &mut Isolate, data: *mut c_void) {
+  let cpu_time = thread_cpu_time();
+  let now = Instant::now();
+  let id = data as usize as u64;
+  let mut state = CPU_WATCHDOG.state.lock().unwrap();
+  let CpuWatchdogState {
+    budgets, deadlines, ..
+  } = &mut *state;
+  // The budget may have been finished before the interrupt was serviced.
+  let budget = match budgets.get_mut(&id) {
+    Some(budget) if !budget.exceeded => budget,
+    _ => return,
+  };
+  budget.check_pending = false;
+  let used = cpu_time.saturating_sub(budget.start_cpu_time);
+  if used >= budget.cpu_limit {
+    budget.exceeded = true;
+    isolate.terminate_execution();
+    return;
+  }
+  budget.deadline =
+    earliest(now + (budget.cpu_limit - used), budget.wall_deadline);
+  deadlines.push(Reverse((budget.deadline, id)));
+  CPU_WATCHDOG.condvar.notify_one();
+}
+
+fn earliest(deadline: Instant, other: Option<Instant>) -> Instant {
+  other.map_or(deadline, |other| other.min(deadline))
+}
+
+/// Returns the CPU time used by the current thread.
+#[cfg(unix)]
+fn thread_cpu_time() -> Duration {
+  let mut time = libc::timespec {
+    tv_sec: 0,
+    tv_nsec: 0,
+  };
+  let result =
+    unsafe { libc::clock_gettime(libc::CLOCK_THREAD_CPUTIME_ID, &mut time) };
+  assert_eq!(result, 0);
+  Duration::new(time.tv_sec as u64, time.tv_nsec as u32)
+}
+
+/// Returns the CPU time used by the current thread. Without a thread CPU
+/// clock, the wall-clock time since an arbitrary point is used instead.
+#[cfg(not(unix))]
+fn thread_cpu_time() -> Duration {
+  lazy_static! {
+    static ref EPOCH: Instant = Instant::now();
   }
+  EPOCH.elapsed()
 }
 
 /// Same as Isolate but gets disposed when it goes out of scope.
@@ -3,8 +3,10 @@
 use crate::Context;
 use crate::HandleScope;
 use crate::Local;
+use crate::NewStringType;
 use crate::String;
 use crate::Value;
+use crate::WriteOptions;
 
 extern "C" {
   fn v8__JSON__Parse(
@@ -41,3 +43,62 @@ pub fn stringify<'s>(
     })
   }
 }
+
+/// Tries to parse the UTF-8 encoded JSON text in `json` and returns it as
+/// value if successful.
+///
+/// The text is decoded straight into a V8 string, without the need to create
+/// (and validate) an intermediate Rust string.
+pub fn parse_utf8<'s>(
+  scope: &mut HandleScope<'s>,
+  json: &[u8],
+) -> Option<Local<'s, Value>> {
+  let json_string = String::new_from_utf8(scope, json, NewStringType::Normal)?;
+  parse(scope, json_string)
+}
+
+/// Like `parse_utf8()`, but takes ownership of `json`. If the text is ASCII,
+/// which is common for JSON, the parser reads it in place through an
+/// external string and no copy is made at all.
+pub fn parse_utf8_owned<'s>(
+  scope: &mut HandleScope<'s>,
+  json: Box<[u8]>,
+) -> Option<Local<'s, Value>> {
+  if !json.is_ascii() {
+    return parse_utf8(scope, &json);
+  }
+  let json_string = String::new_external_onebyte(scope, json)?;
+  parse(scope, json_string)
+}
+
+/// Tries to stringify the JSON-serializable object `json_object` and appends
+/// the result, encoded as UTF-8, to `buffer`. Returns the number of bytes
+/// appended if successful.
+///
+/// The result is written into `buffer` directly, so unlike converting the
+/// string returned by `stringify()` there is no intermediate Rust string.
+pub fn stringify_into<'s>(
+  scope: &mut HandleScope<'s>,
+  json_object: Local<'s, Value>,
+  buffer: &mut Vec<u8>,
+) -> Option<usize> {
+  let json_string = stringify(scope, json_object)?;
+  let length = json_string.utf8_length(scope);
+  buffer.reserve(length);
+  let start = buffer.len();
+  let written = unsafe {
+    let spare = std::slice::from_raw_parts_mut(
+      buffer.as_mut_ptr().add(start),
+      buffer.capacity() - start,
+    );
+    let written = json_string.write_utf8(
+      scope,
+      spare,
+      None,
+      WriteOptions::NO_NULL_TERMINATION | WriteOptions::REPLACE_INVALID_UTF8,
+    );
+    buffer.set_len(start + written);
+    written
+  };
+  Some(written)
+}
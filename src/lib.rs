@@ -35,8 +35,11 @@ extern crate libc;
 
 mod array_buffer;
 mod array_buffer_view;
+mod async_context;
 mod bigint;
 mod context;
+mod coverage;
+mod cpu_profiler;
 mod data;
 mod date;
 mod exception;
@@ -45,14 +48,21 @@ mod external_references;
 mod fixed_array;
 mod function;
 mod handle;
+mod heap_profiler;
+mod heap_snapshot;
 pub mod icu;
+mod interrupt;
 mod isolate;
 mod isolate_create_params;
+mod microtask;
 mod module;
 mod name;
 mod number;
 mod object;
+mod op_ring;
 mod platform;
+mod pool_allocator;
+mod pprof;
 mod primitive_array;
 mod primitives;
 mod private;
@@ -68,6 +78,7 @@ mod string;
 mod support;
 mod symbol;
 mod template;
+mod transfer_table;
 mod typed_array;
 mod unbound_module_script;
 mod unbound_script;
@@ -76,6 +87,7 @@ mod value_deserializer;
 mod value_serializer;
 mod wasm;
 
+pub mod convert;
 pub mod inspector;
 pub mod json;
 pub mod script_compiler;
@@ -85,7 +97,14 @@ pub mod script_compiler;
 pub mod V8;
 
 pub use array_buffer::*;
+pub use async_context::AsyncContextVariable;
 pub use bigint::*;
+pub use coverage::Coverage;
+pub use coverage::CoverageMode;
+pub use coverage::CoverageRange;
+pub use coverage::FunctionCoverage;
+pub use coverage::ScriptCoverage;
+pub use cpu_profiler::*;
 pub use data::*;
 pub use exception::*;
 pub use external_references::ExternalReference;
@@ -94,6 +113,19 @@ pub use function::*;
 pub use handle::Global;
 pub use handle::Handle;
 pub use handle::Local;
+pub use heap_profiler::AllocationProfile;
+pub use heap_profiler::AllocationProfileAllocation;
+pub use heap_profiler::AllocationProfileNode;
+pub use heap_profiler::AllocationProfileSample;
+pub use heap_snapshot::HeapSnapshotCompression;
+pub use heap_snapshot::HeapSnapshotProgress;
+pub use heap_snapshot::HeapSnapshotWriteOptions;
+pub use isolate::AtomicsWaitCallback;
+pub use isolate::AtomicsWaitEvent;
+pub use isolate::AtomicsWaitWakeHandle;
+pub use isolate::CpuBudget;
+pub use isolate::CpuBudgetGuard;
+pub use isolate::CpuBudgetUsage;
 pub use isolate::HeapStatistics;
 pub use isolate::HostImportModuleDynamicallyWithImportAssertionsCallback;
 pub use isolate::HostInitializeImportMetaObjectCallback;
@@ -107,11 +139,15 @@ pub use isolate::PromiseHook;
 pub use isolate::PromiseHookType;
 pub use isolate::PromiseRejectCallback;
 pub use isolate_create_params::CreateParams;
+pub use microtask::MicrotaskQueue;
 pub use module::*;
 pub use object::*;
+pub use op_ring::OpRing;
 pub use platform::new_default_platform;
 pub use platform::new_single_threaded_default_platform;
 pub use platform::Platform;
+pub use pool_allocator::PoolAllocator;
+pub use pool_allocator::PoolAllocatorStats;
 pub use primitives::*;
 pub use private::*;
 pub use promise::{PromiseRejectEvent, PromiseRejectMessage, PromiseState};
@@ -135,12 +171,14 @@ pub use support::UniquePtr;
 pub use support::UniqueRef;
 pub use symbol::*;
 pub use template::*;
+pub use transfer_table::TransferTable;
 pub use value_deserializer::ValueDeserializer;
 pub use value_deserializer::ValueDeserializerHelper;
 pub use value_deserializer::ValueDeserializerImpl;
 pub use value_serializer::ValueSerializer;
 pub use value_serializer::ValueSerializerHelper;
 pub use value_serializer::ValueSerializerImpl;
+pub use wasm::CompiledWasmModule;
 pub use wasm::WasmStreaming;
 
 // TODO(piscisaureus): Ideally this trait would not be exported.
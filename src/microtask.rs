@@ -0,0 +1,89 @@
+// Copyright 2019-2021 the Deno authors. All rights reserved. MIT license.
+use crate::support::int;
+use crate::support::Opaque;
+use crate::support::UniqueRef;
+use crate::Function;
+use crate::Isolate;
+use crate::Local;
+use crate::MicrotasksPolicy;
+
+extern "C" {
+  fn v8__MicrotaskQueue__New(
+    isolate: *mut Isolate,
+    policy: MicrotasksPolicy,
+  ) -> *mut MicrotaskQueue;
+  fn v8__MicrotaskQueue__DELETE(this: *mut MicrotaskQueue);
+  fn v8__MicrotaskQueue__PerformCheckpoint(
+    isolate: *mut Isolate,
+    this: *const MicrotaskQueue,
+  );
+  fn v8__MicrotaskQueue__IsRunningMicrotasks(
+    this: *const MicrotaskQueue,
+  ) -> bool;
+  fn v8__MicrotaskQueue__GetMicrotasksScopeDepth(
+    this: *const MicrotaskQueue,
+  ) -> int;
+  fn v8__MicrotaskQueue__EnqueueMicrotask(
+    isolate: *mut Isolate,
+    this: *const MicrotaskQueue,
+    callback: *const Function,
+  );
+}
+
+/// Represents the microtask queue, where microtasks are stored and processed.
+/// https://html.spec.whatwg.org/multipage/webappapis.html#microtask-queue
+/// https://html.spec.whatwg.org/multipage/webappapis.html#enqueuejob(queuename,-job,-arguments)
+/// https://html.spec.whatwg.org/multipage/webappapis.html#perform-a-microtask-checkpoint
+///
+/// A MicrotaskQueue instance may be associated to multiple Contexts by
+/// passing it to `Context::new_with_microtask_queue()`, and a Context which
+/// is created without one uses the isolate's default MicrotaskQueue (the one
+/// drained by `Isolate::perform_microtask_checkpoint()`). Giving every tenant
+/// of an isolate its own queue lets the embedder decide when, and how often,
+/// each tenant's microtasks are run. The isolate holds on to the queues of
+/// its contexts, so they stay alive as long as the contexts might.
+#[repr(C)]
+#[derive(Debug)]
+pub struct MicrotaskQueue(Opaque);
+
+impl MicrotaskQueue {
+  /// Creates an empty MicrotaskQueue instance.
+  pub fn new(
+    isolate: &mut Isolate,
+    policy: MicrotasksPolicy,
+  ) -> UniqueRef<Self> {
+    unsafe { UniqueRef::from_raw(v8__MicrotaskQueue__New(isolate, policy)) }
+  }
+
+  /// Enqueues the callback to the queue.
+  pub fn enqueue_microtask(
+    &self,
+    isolate: &mut Isolate,
+    microtask: Local<Function>,
+  ) {
+    unsafe { v8__MicrotaskQueue__EnqueueMicrotask(isolate, self, &*microtask) }
+  }
+
+  /// Runs microtasks if no microtask is running on this MicrotaskQueue
+  /// instance. Any exceptions thrown by microtask callbacks are swallowed.
+  pub fn perform_checkpoint(&self, isolate: &mut Isolate) {
+    unsafe { v8__MicrotaskQueue__PerformCheckpoint(isolate, self) }
+  }
+
+  /// Returns true if a microtask is running on this MicrotaskQueue instance.
+  pub fn is_running_microtasks(&self) -> bool {
+    unsafe { v8__MicrotaskQueue__IsRunningMicrotasks(self) }
+  }
+
+  /// Returns the current depth of nested MicrotasksScope that has
+  /// kRunMicrotasks.
+  pub fn get_microtasks_scope_depth(&self) -> i32 {
+    unsafe { v8__MicrotaskQueue__GetMicrotasksScopeDepth(self) }
+  }
+}
+
+impl Drop for MicrotaskQueue {
+  fn drop(&mut self) {
+    unsafe { v8__MicrotaskQueue__DELETE(self) }
+  }
+}
@@ -72,6 +72,27 @@ extern "C" {
     key: *const Name,
     value: *const Value,
   ) -> MaybeBool;
+  fn v8__Object__CreateDataProperties(
+    this: *const Object,
+    context: *const Context,
+    keys: *const *const Name,
+    values: *const *const Value,
+    length: usize,
+  ) -> MaybeBool;
+  fn v8__Object__GetProperties(
+    this: *const Object,
+    context: *const Context,
+    keys: *const *const Name,
+    values: *mut *const Value,
+    length: usize,
+  ) -> bool;
+  fn v8__Object__GetElements(
+    this: *const Object,
+    context: *const Context,
+    start: u32,
+    values: *mut *const Value,
+    length: u32,
+  ) -> bool;
   fn v8__Object__DefineOwnProperty(
     this: *const Object,
     context: *const Context,
@@ -252,6 +273,36 @@ impl Object {
     .into()
   }
 
+  /// Calls `create_data_property()` for every key/value pair, crossing the
+  /// FFI boundary once. Unlike `with_prototype_and_properties()`, which
+  /// creates a dictionary-mode object, objects filled in this way keep the
+  /// fast-property map shared with other objects that have the same shape.
+  ///
+  /// Returns true if all properties were created, or None if an exception
+  /// was thrown.
+  ///
+  /// This is a convenience function not present in the original V8 API.
+  pub fn create_data_properties(
+    &self,
+    scope: &mut HandleScope,
+    keys: &[Local<Name>],
+    values: &[Local<Value>],
+  ) -> Option<bool> {
+    assert_eq!(keys.len(), values.len());
+    let keys = Local::slice_into_raw(keys);
+    let values = Local::slice_into_raw(values);
+    unsafe {
+      v8__Object__CreateDataProperties(
+        self,
+        &*scope.get_current_context(),
+        keys.as_ptr(),
+        values.as_ptr(),
+        keys.len(),
+      )
+    }
+    .into()
+  }
+
   /// Implements DefineOwnProperty.
   ///
   /// In general, CreateDataProperty will be faster, however, does not allow
@@ -288,6 +339,38 @@ impl Object {
     }
   }
 
+  /// Looks up the value of every key in `keys` and stores it at the same
+  /// position in `values`, crossing the FFI boundary once. Returns None if an
+  /// exception was thrown by a getter, in which case `values` is partially
+  /// filled in.
+  ///
+  /// This is a convenience function not present in the original V8 API.
+  pub fn get_properties<'s>(
+    &self,
+    scope: &mut HandleScope<'s>,
+    keys: &[Local<Name>],
+    values: &mut [Option<Local<'s, Value>>],
+  ) -> Option<()> {
+    assert_eq!(keys.len(), values.len());
+    let keys = Local::slice_into_raw(keys);
+    // `Option<Local>` has the same representation as a nullable pointer.
+    let values_ptr = values.as_mut_ptr() as *mut *const Value;
+    let ok = unsafe {
+      v8__Object__GetProperties(
+        self,
+        &*scope.get_current_context(),
+        keys.as_ptr(),
+        values_ptr,
+        keys.len(),
+      )
+    };
+    if ok {
+      Some(())
+    } else {
+      None
+    }
+  }
+
   pub fn get_index<'s>(
     &self,
     scope: &mut HandleScope<'s>,
@@ -300,6 +383,38 @@ impl Object {
     }
   }
 
+  /// Looks up the elements at the indices `start..start + values.len()` and
+  /// stores them in `values`, crossing the FFI boundary once. Returns None if
+  /// an exception was thrown by a getter, in which case `values` is partially
+  /// filled in.
+  ///
+  /// This is a convenience function not present in the original V8 API.
+  pub fn get_elements<'s>(
+    &self,
+    scope: &mut HandleScope<'s>,
+    start: u32,
+    values: &mut [Option<Local<'s, Value>>],
+  ) -> Option<()> {
+    let length = u32::try_from(values.len()).ok()?;
+    start.checked_add(length)?;
+    // `Option<Local>` has the same representation as a nullable pointer.
+    let values_ptr = values.as_mut_ptr() as *mut *const Value;
+    let ok = unsafe {
+      v8__Object__GetElements(
+        self,
+        &*scope.get_current_context(),
+        start,
+        values_ptr,
+        length,
+      )
+    };
+    if ok {
+      Some(())
+    } else {
+      None
+    }
+  }
+
   /// Get the prototype object. This does not skip objects marked to be
   /// skipped by proto and it does not consult the security handler.
   pub fn get_prototype<'s>(
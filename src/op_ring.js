@@ -0,0 +1,65 @@
+// Copyright 2019-2021 the Deno authors. All rights reserved. MIT license.
+
+// JavaScript side of `OpRing` (see op_ring.rs). Evaluating this file yields
+// the OpRing class, which is constructed with the ring's SharedArrayBuffer.
+//
+// Records are written ahead of the published tail and only become visible to
+// the consumer when flush() is called, so a whole batch of records costs a
+// single atomic store (plus one call into Rust to drain them).
+(class OpRing {
+  constructor(buffer) {
+    this.i32 = new Int32Array(buffer);
+    this.u8 = new Uint8Array(buffer);
+    this.capacity = this.i32[1];
+    this.recordSize = this.i32[2];
+    this.mask = this.capacity - 1;
+    this.tail = Atomics.load(this.i32, 16);
+  }
+
+  // Producer: returns the byte offset of the next free record, or -1 if the
+  // ring is full. The record is added to the batch by commit().
+  reserve() {
+    const head = Atomics.load(this.i32, 0);
+    if (((this.tail - head) | 0) >= this.capacity) {
+      return -1;
+    }
+    return 128 + (this.tail & this.mask) * this.recordSize;
+  }
+
+  commit() {
+    this.tail = (this.tail + 1) | 0;
+  }
+
+  // Producer: publishes all committed records to the consumer.
+  flush() {
+    Atomics.store(this.i32, 16, this.tail);
+  }
+
+  // Producer: copies `bytes` (a Uint8Array of at most recordSize bytes) into
+  // the next record and commits it. Returns false if the ring is full.
+  push(bytes) {
+    const offset = this.reserve();
+    if (offset < 0) {
+      return false;
+    }
+    this.u8.set(bytes, offset);
+    this.u8.fill(0, offset + bytes.length, offset + this.recordSize);
+    this.commit();
+    return true;
+  }
+
+  // Consumer: calls fn(offset) for every published record, then releases the
+  // records to the producer. Returns the number of records.
+  drain(fn) {
+    let head = Atomics.load(this.i32, 0);
+    const tail = Atomics.load(this.i32, 16);
+    let count = 0;
+    while (head !== tail) {
+      fn(128 + (head & this.mask) * this.recordSize);
+      head = (head + 1) | 0;
+      count++;
+    }
+    Atomics.store(this.i32, 0, head);
+    return count;
+  }
+})
@@ -0,0 +1,224 @@
+// Copyright 2019-2021 the Deno authors. All rights reserved. MIT license.
+
+use std::slice;
+use std::sync::atomic::AtomicU32;
+use std::sync::atomic::AtomicU64;
+use std::sync::atomic::Ordering;
+
+use crate::support::SharedRef;
+use crate::BackingStore;
+use crate::HandleScope;
+use crate::Isolate;
+use crate::Local;
+use crate::SharedArrayBuffer;
+
+// Layout of the header at the start of the buffer. The head (written by the
+// consumer) and the tail (written by the producer) live on separate cache
+// lines. op_ring.js hard-codes these offsets.
+const HEAD_OFFSET: usize = 0;
+const CAPACITY_OFFSET: usize = 4;
+const RECORD_SIZE_OFFSET: usize = 8;
+const TAIL_OFFSET: usize = 64;
+const HEADER_SIZE: usize = 128;
+
+/// A single-producer, single-consumer queue of fixed-size records in a
+/// SharedArrayBuffer, for submitting many small operations between
+/// JavaScript and Rust without a function call per operation.
+///
+/// JavaScript uses the class returned by evaluating `OpRing::JS_SOURCE`:
+///
+/// ```js
+/// const ring = new OpRing(sharedArrayBuffer);
+/// for (const op of ops) {
+///   const offset = ring.reserve();
+///   if (offset < 0) { ring.flush(); drainOps(); continue; /* retry */ }
+///   view.setUint32(offset, op.id, true); // ...fill in the record
+///   ring.commit();
+/// }
+/// ring.flush();
+/// drainOps(); // One FunctionCallback that calls `OpRing::drain()`.
+/// ```
+///
+/// Either side can be the producer; a ring carries records in one direction
+/// only, so bidirectional traffic needs two rings. Head and tail are
+/// updated with atomic operations, so producer and consumer may also run
+/// on different threads (e.g. a worker isolate sharing the backing store).
+///
+/// JavaScript can write to the buffer at any time, so Rust only ever
+/// accesses it with atomic operations, and records are copied in and out
+/// rather than borrowed.
+pub struct OpRing {
+  backing_store: SharedRef<BackingStore>,
+  capacity: u32,
+  record_size: usize,
+}
+
+impl OpRing {
+  /// JavaScript source of the `OpRing` class that implements the producer
+  /// and consumer operations on the ring's SharedArrayBuffer.
+  pub const JS_SOURCE: &'static str = include_str!("op_ring.js");
+
+  /// Creates a ring with room for `capacity` records of `record_size` bytes
+  /// each, allocated by the isolate's ArrayBuffer allocator. `capacity` must
+  /// be a power of two, and `record_size` a multiple of 8 so that records
+  /// can be accessed with any typed array.
+  pub fn new(isolate: &mut Isolate, capacity: u32, record_size: usize) -> Self {
+    assert!(capacity.is_power_of_two() && capacity <= 1 << 30);
+    assert!(record_size > 0 && record_size % 8 == 0);
+    let byte_length = HEADER_SIZE + capacity as usize * record_size;
+    let backing_store =
+      SharedArrayBuffer::new_backing_store(isolate, byte_length).make_shared();
+    let ring = Self {
+      backing_store,
+      capacity,
+      record_size,
+    };
+    ring
+      .word(CAPACITY_OFFSET)
+      .store(capacity, Ordering::Relaxed);
+    ring
+      .word(RECORD_SIZE_OFFSET)
+      .store(record_size as u32, Ordering::Relaxed);
+    ring
+  }
+
+  /// Wraps the backing store of an existing ring, e.g. one received from
+  /// another isolate. Returns None if the backing store doesn't contain a
+  /// valid ring header.
+  ///
+  /// The header is only checked for consistency, so any SharedArrayBuffer
+  /// that happens to start with a valid header is accepted. That can't cause
+  /// memory unsafety: the capacity and record size are read once and checked
+  /// against the size of the buffer, and all other accesses are atomic and
+  /// bounds checked, so a buffer that isn't a ring only yields garbage
+  /// records.
+  pub fn from_backing_store(
+    backing_store: SharedRef<BackingStore>,
+  ) -> Option<Self> {
+    if !backing_store.is_shared()
+      || backing_store.byte_length() < HEADER_SIZE
+      || backing_store.data() as usize % 8 != 0
+    {
+      return None;
+    }
+    let mut ring = Self {
+      backing_store,
+      capacity: 0,
+      record_size: 0,
+    };
+    ring.capacity = ring.word(CAPACITY_OFFSET).load(Ordering::Relaxed);
+    ring.record_size =
+      ring.word(RECORD_SIZE_OFFSET).load(Ordering::Relaxed) as usize;
+    let valid = ring.capacity.is_power_of_two()
+      && ring.record_size % 8 == 0
+      && ring.record_size > 0
+      && (ring.capacity as usize)
+        .checked_mul(ring.record_size)
+        .and_then(|len| len.checked_add(HEADER_SIZE))
+        .map_or(false, |len| len <= ring.backing_store.byte_length());
+    if valid {
+      Some(ring)
+    } else {
+      None
+    }
+  }
+
+  /// Creates a SharedArrayBuffer for the ring, to be passed to the
+  /// JavaScript `OpRing` constructor.
+  pub fn shared_array_buffer<'s>(
+    &self,
+    scope: &mut HandleScope<'s>,
+  ) -> Local<'s, SharedArrayBuffer> {
+    SharedArrayBuffer::with_backing_store(scope, &self.backing_store)
+  }
+
+  pub fn backing_store(&self) -> &SharedRef<BackingStore> {
+    &self.backing_store
+  }
+
+  pub fn capacity(&self) -> usize {
+    self.capacity as usize
+  }
+
+  pub fn record_size(&self) -> usize {
+    self.record_size
+  }
+
+  /// Number of records that have been published but not yet drained.
+  pub fn len(&self) -> usize {
+    let tail = self.word(TAIL_OFFSET).load(Ordering::Acquire);
+    let head = self.word(HEAD_OFFSET).load(Ordering::Acquire);
+    tail.wrapping_sub(head) as usize
+  }
+
+  pub fn is_empty(&self) -> bool {
+    self.len() == 0
+  }
+
+  /// Producer: appends `record` (at most `record_size()` bytes; the rest of
+  /// the record is zeroed) and publishes it right away. Returns false if the
+  /// ring is full.
+  pub fn push(&self, record: &[u8]) -> bool {
+    assert!(record.len() <= self.record_size);
+    let tail = self.word(TAIL_OFFSET).load(Ordering::Relaxed);
+    let head = self.word(HEAD_OFFSET).load(Ordering::Acquire);
+    if tail.wrapping_sub(head) >= self.capacity {
+      return false;
+    }
+    for (i, word) in self.record_words(tail).iter().enumerate() {
+      let start = (i * 8).min(record.len());
+      let end = (start + 8).min(record.len());
+      let mut bytes = [0u8; 8];
+      bytes[..end - start].copy_from_slice(&record[start..end]);
+      word.store(u64::from_ne_bytes(bytes), Ordering::Relaxed);
+    }
+    self
+      .word(TAIL_OFFSET)
+      .store(tail.wrapping_add(1), Ordering::Release);
+    true
+  }
+
+  /// Consumer: calls `f` with every published record, in order, and then
+  /// hands the records back to the producer. Returns the number of records.
+  ///
+  /// The records published at the time of the call are drained; records
+  /// that are published while `f` runs are left for the next call.
+  ///
+  /// `f` receives a copy of each record, since a misbehaving producer could
+  /// still be writing to it.
+  pub fn drain(&self, mut f: impl FnMut(&[u8])) -> usize {
+    let head = self.word(HEAD_OFFSET).load(Ordering::Relaxed);
+    let tail = self.word(TAIL_OFFSET).load(Ordering::Acquire);
+    // A misbehaving producer can't make the consumer read out of bounds, but
+    // it could make it loop for a long time.
+    let count = tail.wrapping_sub(head).min(self.capacity);
+    let mut record = vec![0u8; self.record_size];
+    for i in 0..count {
+      let words = self.record_words(head.wrapping_add(i));
+      for (bytes, word) in record.chunks_exact_mut(8).zip(words) {
+        bytes.copy_from_slice(&word.load(Ordering::Relaxed).to_ne_bytes());
+      }
+      f(&record);
+    }
+    self
+      .word(HEAD_OFFSET)
+      .store(head.wrapping_add(count), Ordering::Release);
+    count as usize
+  }
+
+  fn word(&self, offset: usize) -> &AtomicU32 {
+    unsafe {
+      let data = self.backing_store.data() as *const u8;
+      &*(data.add(offset) as *const AtomicU32)
+    }
+  }
+
+  fn record_words(&self, index: u32) -> &[AtomicU64] {
+    let slot = (index & (self.capacity - 1)) as usize;
+    unsafe {
+      let data = (self.backing_store.data() as *const u8)
+        .add(HEADER_SIZE + slot * self.record_size);
+      slice::from_raw_parts(data as *const AtomicU64, self.record_size / 8)
+    }
+  }
+}
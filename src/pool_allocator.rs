@@ -0,0 +1,559 @@
+// Copyright 2019-2021 the Deno authors. All rights reserved. MIT license.
+
+use std::alloc::alloc;
+use std::alloc::alloc_zeroed;
+use std::alloc::dealloc;
+use std::alloc::realloc;
+use std::alloc::Layout;
+use std::cell::RefCell;
+use std::ffi::c_void;
+use std::ptr;
+use std::ptr::null_mut;
+use std::sync::atomic::AtomicUsize;
+use std::sync::atomic::Ordering;
+use std::sync::Arc;
+
+use crate::array_buffer::new_rust_allocator;
+use crate::array_buffer::Allocator;
+use crate::array_buffer::RustAllocatorVtable;
+use crate::support::UniqueRef;
+
+/// Alignment of every buffer handed out by the allocator. V8 requires at
+/// least the alignment of the largest typed array element (8 bytes).
+const ALIGN: usize = 16;
+
+/// Buffers of up to `MAX_SMALL_SIZE` bytes are rounded up to a power of two
+/// (at least `MIN_SMALL_SIZE`) and recycled through per-thread caches.
+const MIN_SMALL_SIZE_LOG2: usize = 4;
+const MAX_SMALL_SIZE_LOG2: usize = 16;
+const MAX_SMALL_SIZE: usize = 1 << MAX_SMALL_SIZE_LOG2;
+const SIZE_CLASS_COUNT: usize = MAX_SMALL_SIZE_LOG2 - MIN_SMALL_SIZE_LOG2 + 1;
+
+/// Upper bound for the memory a thread keeps cached per size class.
+const CACHE_BYTES_PER_SIZE_CLASS: usize = 1 << 20;
+const MAX_CACHED_PER_SIZE_CLASS: usize = 64;
+
+/// Buffers of at least `HUGE_PAGE_SIZE` bytes are mapped directly from the
+/// kernel (where available) and marked as eligible for transparent huge
+/// pages. Freshly mapped memory is zeroed by the kernel, so these don't need
+/// to be cleared either.
+const HUGE_PAGE_SIZE: usize = 2 << 20;
+
+/// Counters kept by a `PoolAllocator`. See `PoolAllocator::stats()`.
+#[derive(Clone, Copy, Debug, Default, PartialEq)]
+pub struct PoolAllocatorStats {
+  /// Number of bytes currently allocated for ArrayBuffers.
+  pub live_bytes: usize,
+  /// Highest value `live_bytes` has reached.
+  pub peak_bytes: usize,
+  /// Number of allocations, including the ones done by reallocation.
+  pub allocations: usize,
+  /// Number of buffers that have been freed.
+  pub frees: usize,
+  /// Number of allocations that were refused because of the quota.
+  pub rejected_allocations: usize,
+}
+
+#[derive(Default)]
+struct PoolAllocatorInner {
+  quota: AtomicUsize,
+  live_bytes: AtomicUsize,
+  peak_bytes: AtomicUsize,
+  allocations: AtomicUsize,
+  frees: AtomicUsize,
+  rejected_allocations: AtomicUsize,
+}
+
+/// An ArrayBuffer allocator that is tuned for the allocation patterns of
+/// ArrayBuffer-heavy code and keeps statistics about the memory it hands
+/// out.
+///
+/// * Small buffers (up to 64 KiB) are grouped in power-of-two size classes.
+///   Freed buffers go into a per-thread cache and are reused by the next
+///   allocation of the same class, so short-lived buffers don't hit the
+///   global allocator at all.
+/// * Large buffers (2 MiB and up) are mapped directly and advised to use
+///   transparent huge pages on Linux.
+/// * `AllocateUninitialized()`, which V8 uses when it is going to overwrite
+///   the whole buffer anyway, skips zeroing.
+///
+/// Give every isolate its own allocator (`make_allocator()` can be called
+/// once per isolate on a fresh `PoolAllocator`) to get per-isolate
+/// statistics and quotas.
+///
+/// ```ignore
+/// let pool = v8::PoolAllocator::new();
+/// pool.set_quota(Some(256 << 20));
+/// let params = v8::Isolate::create_params()
+///   .array_buffer_allocator(pool.make_allocator());
+/// let isolate = &mut v8::Isolate::new(params);
+/// // ...
+/// println!("{:?}", pool.stats());
+/// ```
+#[derive(Clone, Default)]
+pub struct PoolAllocator(Arc<PoolAllocatorInner>);
+
+impl PoolAllocator {
+  pub fn new() -> Self {
+    Default::default()
+  }
+
+  /// Creates the `v8::ArrayBuffer::Allocator` that allocates through this
+  /// pool, to be passed to `CreateParams::array_buffer_allocator()`.
+  pub fn make_allocator(&self) -> UniqueRef<Allocator> {
+    let handle = Arc::into_raw(self.0.clone());
+    unsafe { new_rust_allocator(handle, &VTABLE) }
+  }
+
+  /// Limits the number of bytes that can be allocated at the same time.
+  /// Allocations that would exceed the quota fail, which makes V8 throw a
+  /// RangeError ("Array buffer allocation failed"). Buffers that are already
+  /// allocated are not affected when the quota is lowered.
+  pub fn set_quota(&self, quota: Option<usize>) {
+    let quota = quota.unwrap_or(0);
+    self.0.quota.store(quota, Ordering::Relaxed);
+  }
+
+  pub fn quota(&self) -> Option<usize> {
+    match self.0.quota.load(Ordering::Relaxed) {
+      0 => None,
+      quota => Some(quota),
+    }
+  }
+
+  pub fn stats(&self) -> PoolAllocatorStats {
+    let inner = &*self.0;
+    PoolAllocatorStats {
+      live_bytes: inner.live_bytes.load(Ordering::Relaxed),
+      peak_bytes: inner.peak_bytes.load(Ordering::Relaxed),
+      allocations: inner.allocations.load(Ordering::Relaxed),
+      frees: inner.frees.load(Ordering::Relaxed),
+      rejected_allocations: inner.rejected_allocations.load(Ordering::Relaxed),
+    }
+  }
+}
+
+impl PoolAllocatorInner {
+  /// Accounts for `len` more live bytes. Returns false if that would exceed
+  /// the quota.
+  fn reserve(&self, len: usize) -> bool {
+    let quota = self.quota.load(Ordering::Relaxed);
+    let live = self.live_bytes.fetch_add(len, Ordering::Relaxed) + len;
+    if quota != 0 && live > quota {
+      self.live_bytes.fetch_sub(len, Ordering::Relaxed);
+      self.rejected_allocations.fetch_add(1, Ordering::Relaxed);
+      return false;
+    }
+    self.peak_bytes.fetch_max(live, Ordering::Relaxed);
+    true
+  }
+
+  fn unreserve(&self, len: usize) {
+    self.live_bytes.fetch_sub(len, Ordering::Relaxed);
+  }
+
+  fn allocate(&self, len: usize, zeroed: bool) -> *mut c_void {
+    if !self.reserve(len) {
+      return null_mut();
+    }
+    let data = unsafe { allocate_block(len, zeroed) };
+    if data.is_null() {
+      self.unreserve(len);
+    } else {
+      self.allocations.fetch_add(1, Ordering::Relaxed);
+    }
+    data as *mut c_void
+  }
+
+  fn free(&self, data: *mut c_void, len: usize) {
+    if data.is_null() {
+      return;
+    }
+    unsafe { free_block(data as *mut u8, len) };
+    self.unreserve(len);
+    self.frees.fetch_add(1, Ordering::Relaxed);
+  }
+
+  /// Resizes a block without moving it to a new allocation if possible:
+  /// small blocks stay where they are as long as the size class doesn't
+  /// change, medium blocks are resized by the global allocator (which can
+  /// often grow them in place), and huge blocks are remapped with `mremap()`
+  /// on Linux, which moves page table entries rather than copying memory.
+  fn reallocate(
+    &self,
+    data: *mut c_void,
+    old_len: usize,
+    new_len: usize,
+  ) -> *mut c_void {
+    if data.is_null() {
+      // V8 doesn't allocate memory for empty backing stores.
+      return self.allocate(new_len, true);
+    }
+    let data = data as *mut u8;
+    let old_kind = block_kind(old_len);
+    let new_kind = block_kind(new_len);
+    let in_place = match (old_kind, new_kind) {
+      (BlockKind::Small(old), BlockKind::Small(new)) => old == new,
+      (BlockKind::Medium, BlockKind::Medium) => true,
+      (BlockKind::Huge, BlockKind::Huge) => cfg!(target_os = "linux"),
+      _ => false,
+    };
+    if in_place {
+      let grow = new_len.saturating_sub(old_len);
+      if !self.reserve(grow) {
+        return null_mut();
+      }
+      let new_data = match new_kind {
+        BlockKind::Small(_) => data,
+        BlockKind::Medium => unsafe {
+          let layout = Layout::from_size_align(old_len, ALIGN).unwrap();
+          realloc(data, layout, new_len)
+        },
+        BlockKind::Huge => unsafe { remap_huge(data, old_len, new_len) },
+      };
+      if new_data.is_null() {
+        // The original block is still valid.
+        self.unreserve(grow);
+        return null_mut();
+      }
+      if grow == 0 {
+        self.unreserve(old_len - new_len);
+      } else {
+        // Huge blocks grow by mapping fresh pages, which are already zeroed,
+        // so only the rest of the last old page needs to be cleared.
+        let dirty = match new_kind {
+          BlockKind::Huge => grow.min(page_size() - old_len % page_size()),
+          _ => grow,
+        };
+        unsafe { ptr::write_bytes(new_data.add(old_len), 0, dirty) };
+      }
+      return new_data as *mut c_void;
+    }
+    let new_data = self.allocate(new_len, false) as *mut u8;
+    if new_data.is_null() {
+      return null_mut();
+    }
+    unsafe {
+      let copied = old_len.min(new_len);
+      ptr::copy_nonoverlapping(data as *const u8, new_data, copied);
+      ptr::write_bytes(new_data.add(copied), 0, new_len - copied);
+    }
+    self.free(data as *mut c_void, old_len);
+    new_data as *mut c_void
+  }
+}
+
+#[derive(Clone, Copy, PartialEq, Debug)]
+enum BlockKind {
+  /// Index into the size classes.
+  Small(usize),
+  Medium,
+  Huge,
+}
+
+fn block_kind(len: usize) -> BlockKind {
+  if len <= MAX_SMALL_SIZE {
+    let log2 = len.max(1).next_power_of_two().trailing_zeros() as usize;
+    BlockKind::Small(log2.max(MIN_SMALL_SIZE_LOG2) - MIN_SMALL_SIZE_LOG2)
+  } else if len < HUGE_PAGE_SIZE || !cfg!(unix) {
+    BlockKind::Medium
+  } else {
+    BlockKind::Huge
+  }
+}
+
+fn size_class_layout(index: usize) -> Layout {
+  let size = 1 << (index + MIN_SMALL_SIZE_LOG2);
+  Layout::from_size_align(size, ALIGN).unwrap()
+}
+
+unsafe fn allocate_block(len: usize, zeroed: bool) -> *mut u8 {
+  match block_kind(len) {
+    BlockKind::Small(index) => {
+      let data = THREAD_CACHE
+        .try_with(|cache| cache.borrow_mut().pop(index))
+        .ok()
+        .flatten();
+      match data {
+        Some(data) => {
+          if zeroed {
+            ptr::write_bytes(data, 0, len);
+          }
+          data
+        }
+        None => {
+          // A fresh block only needs to be zeroed if it is requested so.
+          let layout = size_class_layout(index);
+          if zeroed {
+            alloc_zeroed(layout)
+          } else {
+            alloc(layout)
+          }
+        }
+      }
+    }
+    BlockKind::Medium => {
+      let layout = Layout::from_size_align(len, ALIGN).unwrap();
+      if zeroed {
+        alloc_zeroed(layout)
+      } else {
+        alloc(layout)
+      }
+    }
+    BlockKind::Huge => map_huge(len),
+  }
+}
+
+unsafe fn free_block(data: *mut u8, len: usize) {
+  match block_kind(len) {
+    BlockKind::Small(index) => {
+      let cached = THREAD_CACHE
+        .try_with(|cache| cache.borrow_mut().push(index, data))
+        .unwrap_or(false);
+      if !cached {
+        dealloc(data, size_class_layout(index));
+      }
+    }
+    BlockKind::Medium => {
+      dealloc(data, Layout::from_size_align(len, ALIGN).unwrap());
+    }
+    BlockKind::Huge => unmap_huge(data, len),
+  }
+}
+
+#[cfg(unix)]
+unsafe fn map_huge(len: usize) -> *mut u8 {
+  let data = libc::mmap(
+    null_mut(),
+    len,
+    libc::PROT_READ | libc::PROT_WRITE,
+    libc::MAP_PRIVATE | libc::MAP_ANONYMOUS,
+    -1,
+    0,
+  );
+  if data == libc::MAP_FAILED {
+    return null_mut();
+  }
+  #[cfg(target_os = "linux")]
+  libc::madvise(data, len, libc::MADV_HUGEPAGE);
+  data as *mut u8
+}
+
+#[cfg(unix)]
+unsafe fn unmap_huge(data: *mut u8, len: usize) {
+  libc::munmap(data as *mut c_void, len);
+}
+
+#[cfg(unix)]
+fn page_size() -> usize {
+  unsafe { libc::sysconf(libc::_SC_PAGESIZE) as usize }
+}
+
+#[cfg(not(unix))]
+fn page_size() -> usize {
+  unreachable!()
+}
+
+#[cfg(target_os = "linux")]
+unsafe fn remap_huge(data: *mut u8, old_len: usize, new_len: usize) -> *mut u8 {
+  let data =
+    libc::mremap(data as *mut c_void, old_len, new_len, libc::MREMAP_MAYMOVE);
+  if data == libc::MAP_FAILED {
+    return null_mut();
+  }
+  data as *mut u8
+}
+
+#[cfg(not(target_os = "linux"))]
+unsafe fn remap_huge(
+  _data: *mut u8,
+  _old_len: usize,
+  _new_len: usize,
+) -> *mut u8 {
+  unreachable!()
+}
+
+#[cfg(not(unix))]
+unsafe fn map_huge(_len: usize) -> *mut u8 {
+  unreachable!()
+}
+
+#[cfg(not(unix))]
+unsafe fn unmap_huge(_data: *mut u8, _len: usize) {
+  unreachable!()
+}
+
+/// Freed small blocks, per size class. Blocks are plain global-allocator
+/// memory, so a block freed by one thread (or allocator) can be reused by
+/// any other.
+struct ThreadCache {
+  free_lists: [Vec<*mut u8>; SIZE_CLASS_COUNT],
+}
+
+impl ThreadCache {
+  fn pop(&mut self, index: usize) -> Option<*mut u8> {
+    self.free_lists[index].pop()
+  }
+
+  fn push(&mut self, index: usize, data: *mut u8) -> bool {
+    let size = size_class_layout(index).size();
+    let limit =
+      (CACHE_BYTES_PER_SIZE_CLASS / size).min(MAX_CACHED_PER_SIZE_CLASS);
+    let free_list = &mut self.free_lists[index];
+    if free_list.len() >= limit {
+      return false;
+    }
+    free_list.push(data);
+    true
+  }
+}
+
+impl Drop for ThreadCache {
+  fn drop(&mut self) {
+    for (index, free_list) in self.free_lists.iter_mut().enumerate() {
+      for data in free_list.drain(..) {
+        unsafe { dealloc(data, size_class_layout(index)) };
+      }
+    }
+  }
+}
+
+thread_local! {
+  static THREAD_CACHE: RefCell<ThreadCache> = RefCell::new(ThreadCache {
+    free_lists: Default::default(),
+  });
+}
+
+unsafe extern "C" fn allocate(
+  inner: &PoolAllocatorInner,
+  len: usize,
+) -> *mut c_void {
+  inner.allocate(len, true)
+}
+
+unsafe extern "C" fn allocate_uninitialized(
+  inner: &PoolAllocatorInner,
+  len: usize,
+) -> *mut c_void {
+  inner.allocate(len, false)
+}
+
+unsafe extern "C" fn free(
+  inner: &PoolAllocatorInner,
+  data: *mut c_void,
+  len: usize,
+) {
+  inner.free(data, len)
+}
+
+unsafe extern "C" fn reallocate(
+  inner: &PoolAllocatorInner,
+  data: *mut c_void,
+  old_len: usize,
+  new_len: usize,
+) -> *mut c_void {
+  inner.reallocate(data, old_len, new_len)
+}
+
+unsafe extern "C" fn drop(inner: *const PoolAllocatorInner) {
+  Arc::from_raw(inner);
+}
+
+static VTABLE: RustAllocatorVtable<PoolAllocatorInner> = RustAllocatorVtable {
+  allocate,
+  allocate_uninitialized,
+  free,
+  reallocate,
+  drop,
+};
+
+#[test]
+fn test_pool_allocator() {
+  let pool = PoolAllocator::new();
+  let inner = &*pool.0;
+
+  for &len in &[0, 1, 100, 4096, MAX_SMALL_SIZE, MAX_SMALL_SIZE + 1] {
+    let data = inner.allocate(len, true) as *mut u8;
+    assert!(!data.is_null());
+    assert_eq!(data as usize % ALIGN, 0);
+    unsafe {
+      assert!(std::slice::from_raw_parts(data, len)
+        .iter()
+        .all(|&b| b == 0));
+      ptr::write_bytes(data, 0xff, len);
+    }
+    inner.free(data as *mut c_void, len);
+    // The next allocation of the same size class reuses the cached block,
+    // which must be zeroed again.
+    let data = inner.allocate(len, true) as *mut u8;
+    unsafe {
+      assert!(std::slice::from_raw_parts(data, len)
+        .iter()
+        .all(|&b| b == 0));
+    }
+    inner.free(data as *mut c_void, len);
+  }
+
+  let stats = pool.stats();
+  assert_eq!(stats.live_bytes, 0);
+  assert_eq!(stats.peak_bytes, MAX_SMALL_SIZE + 1);
+  assert_eq!(stats.allocations, 12);
+  assert_eq!(stats.frees, 12);
+
+  let data = inner.allocate(10, true) as *mut u8;
+  unsafe { ptr::write_bytes(data, 1, 10) };
+  let data = inner.reallocate(data as *mut c_void, 10, 16) as *mut u8;
+  let data = inner.reallocate(data as *mut c_void, 16, 100) as *mut u8;
+  let contents = unsafe { std::slice::from_raw_parts(data, 100) };
+  assert_eq!(&contents[..10], &[1; 10]);
+  assert!(contents[10..].iter().all(|&b| b == 0));
+  assert_eq!(pool.stats().live_bytes, 100);
+  inner.free(data as *mut c_void, 100);
+
+  let data = inner.allocate(100_000, false) as *mut u8;
+  unsafe { ptr::write_bytes(data, 1, 100_000) };
+  let data = inner.reallocate(data as *mut c_void, 100_000, 200_000) as *mut u8;
+  let contents = unsafe { std::slice::from_raw_parts(data, 200_000) };
+  assert!(contents[..100_000].iter().all(|&b| b == 1));
+  assert!(contents[100_000..].iter().all(|&b| b == 0));
+  inner.free(data as *mut c_void, 200_000);
+  assert_eq!(pool.stats().live_bytes, 0);
+
+  let data = inner.reallocate(null_mut(), 0, 8) as *mut u8;
+  assert!(!data.is_null());
+  inner.free(data as *mut c_void, 8);
+
+  pool.set_quota(Some(1000));
+  let data = inner.allocate(600, false);
+  assert!(!data.is_null());
+  assert!(inner.allocate(600, false).is_null());
+  assert!(inner.reallocate(data, 600, 1200).is_null());
+  inner.free(data, 600);
+  assert_eq!(pool.stats().rejected_allocations, 2);
+  assert_eq!(pool.stats().live_bytes, 0);
+}
+
+#[cfg(unix)]
+#[test]
+fn test_pool_allocator_huge() {
+  let pool = PoolAllocator::new();
+  let inner = &*pool.0;
+  let len = HUGE_PAGE_SIZE * 2;
+  let data = inner.allocate(len, false) as *mut u8;
+  assert!(!data.is_null());
+  unsafe { ptr::write_bytes(data, 7, len) };
+  inner.free(data as *mut c_void, len);
+  assert_eq!(pool.stats().peak_bytes, len);
+
+  let len = HUGE_PAGE_SIZE + 100;
+  let data = inner.allocate(len, true) as *mut u8;
+  unsafe { ptr::write_bytes(data, 7, len) };
+  let data = inner.reallocate(data as *mut c_void, len, len - 50) as *mut u8;
+  let data =
+    inner.reallocate(data as *mut c_void, len - 50, len * 3) as *mut u8;
+  let contents = unsafe { std::slice::from_raw_parts(data, len * 3) };
+  assert!(contents[..len - 50].iter().all(|&b| b == 7));
+  assert!(contents[len - 50..].iter().all(|&b| b == 0));
+  inner.free(data as *mut c_void, len * 3);
+  assert_eq!(pool.stats().live_bytes, 0);
+}
@@ -0,0 +1,349 @@
+// Copyright 2019-2021 the Deno authors. All rights reserved. MIT license.
+
+//! A minimal writer for the pprof profile format
+//! (https://github.com/google/pprof/blob/master/proto/profile.proto).
+//!
+//! Every top-level field of a `Profile` message may appear any number of
+//! times and in any order, so the profile is streamed to the writer one
+//! sample, location and function at a time. Only the string table, whose
+//! indices are handed out as strings are interned, is kept in memory until
+//! `finish()` writes it. The output is not gzipped; `go tool pprof` and
+//! most other consumers accept uncompressed profiles too.
+
+use std::borrow::Cow;
+use std::collections::HashMap;
+use std::io;
+use std::io::Write;
+
+// Field numbers of the `Profile` message.
+const PROFILE_SAMPLE_TYPE: u32 = 1;
+const PROFILE_SAMPLE: u32 = 2;
+const PROFILE_LOCATION: u32 = 4;
+const PROFILE_FUNCTION: u32 = 5;
+const PROFILE_STRING_TABLE: u32 = 6;
+const PROFILE_TIME_NANOS: u32 = 9;
+const PROFILE_DURATION_NANOS: u32 = 10;
+const PROFILE_PERIOD_TYPE: u32 = 11;
+const PROFILE_PERIOD: u32 = 12;
+
+const WIRE_VARINT: u32 = 0;
+const WIRE_LEN: u32 = 2;
+
+/// A node of a profile's call tree: a function, called through the chain of
+/// functions of its ancestors.
+pub(crate) trait ProfileNode {
+  /// Returns the child at `index`, or None if there are no more children.
+  fn child_at(&self, index: usize) -> Option<&Self>;
+  /// Returns the function's name, or an empty string if it is anonymous.
+  fn name(&self) -> Cow<'_, str>;
+  fn file_name(&self) -> Cow<'_, str>;
+  fn line(&self) -> i64;
+  /// Returns a non-zero id that is unique within the tree.
+  fn id(&self) -> u64;
+}
+
+/// Visits `root` and all its descendants in depth-first pre-order. `f` is
+/// called with the path from `root` to the visited node, which is the last
+/// element of the path. The tree is walked without recursion, so deep call
+/// stacks can't overflow the native stack.
+pub(crate) fn walk<'a, N: ProfileNode>(
+  root: &'a N,
+  mut f: impl FnMut(&[&'a N]),
+) {
+  let mut path = vec![root];
+  let mut next_child = vec![0];
+  f(&path);
+  while let Some(&node) = path.last() {
+    let index = next_child.last_mut().unwrap();
+    if let Some(child) = node.child_at(*index) {
+      *index += 1;
+      path.push(child);
+      next_child.push(0);
+      f(&path);
+    } else {
+      path.pop();
+      next_child.pop();
+    }
+  }
+}
+
+pub(crate) struct ProfileWriter<W: Write> {
+  writer: W,
+  strings: HashMap<String, i64>,
+  string_table: Vec<String>,
+  functions: HashMap<(i64, i64, i64), u64>,
+  location_ids: Vec<u64>,
+  message: Vec<u8>,
+  nested: Vec<u8>,
+}
+
+impl<W: Write> ProfileWriter<W> {
+  /// `sample_types` are the (type, unit) pairs describing the values of
+  /// every sample, e.g. `[("samples", "count"), ("cpu", "nanoseconds")]`.
+  pub fn new(
+    writer: W,
+    sample_types: &[(&str, &str)],
+    period_type: (&str, &str),
+    period: i64,
+  ) -> io::Result<Self> {
+    let mut this = Self {
+      writer,
+      strings: HashMap::new(),
+      string_table: Vec::new(),
+      functions: HashMap::new(),
+      location_ids: Vec::new(),
+      message: Vec::new(),
+      nested: Vec::new(),
+    };
+    // The first entry of the string table must be the empty string.
+    this.string("");
+    for &value_type in sample_types {
+      this.value_type(value_type);
+      this.write_message(PROFILE_SAMPLE_TYPE)?;
+    }
+    this.value_type(period_type);
+    this.write_message(PROFILE_PERIOD_TYPE)?;
+    this.write_int(PROFILE_PERIOD, period)?;
+    Ok(this)
+  }
+
+  /// Returns the string table index of `s`.
+  pub fn string(&mut self, s: &str) -> i64 {
+    if let Some(&index) = self.strings.get(s) {
+      return index;
+    }
+    let index = self.string_table.len() as i64;
+    self.strings.insert(s.to_owned(), index);
+    self.string_table.push(s.to_owned());
+    index
+  }
+
+  /// Returns the id of the function with the given name, file name and
+  /// start line, writing it out the first time it is seen.
+  pub fn function(
+    &mut self,
+    name: &str,
+    filename: &str,
+    start_line: i64,
+  ) -> io::Result<u64> {
+    let name = self.string(name);
+    let filename = self.string(filename);
+    let key = (name, filename, start_line);
+    if let Some(&id) = self.functions.get(&key) {
+      return Ok(id);
+    }
+    let id = self.functions.len() as u64 + 1;
+    self.functions.insert(key, id);
+    encode_field(&mut self.message, 1, id);
+    encode_field(&mut self.message, 2, name as u64);
+    encode_field(&mut self.message, 3, name as u64);
+    encode_field(&mut self.message, 4, filename as u64);
+    encode_field(&mut self.message, 5, start_line as u64);
+    self.write_message(PROFILE_FUNCTION)?;
+    Ok(id)
+  }
+
+  /// Writes a location with a single line. `id` must be non-zero and unique.
+  pub fn location(
+    &mut self,
+    id: u64,
+    function_id: u64,
+    line: i64,
+  ) -> io::Result<()> {
+    encode_field(&mut self.nested, 1, function_id);
+    encode_field(&mut self.nested, 2, line as u64);
+    encode_field(&mut self.message, 1, id);
+    encode_nested(&mut self.message, 4, &mut self.nested);
+    self.write_message(PROFILE_LOCATION)
+  }
+
+  /// Writes a sample. `location_ids` lists the stack from the leaf frame to
+  /// the root frame; `values` has one value per sample type.
+  pub fn sample(
+    &mut self,
+    location_ids: &[u64],
+    values: &[i64],
+  ) -> io::Result<()> {
+    for &id in location_ids {
+      encode_varint(&mut self.nested, id);
+    }
+    encode_nested(&mut self.message, 1, &mut self.nested);
+    for &value in values {
+      encode_varint(&mut self.nested, value as u64);
+    }
+    encode_nested(&mut self.message, 2, &mut self.nested);
+    self.write_message(PROFILE_SAMPLE)
+  }
+
+  /// Writes the function and location of the last node of `path`, which is
+  /// the path from the root of a call tree as passed to `walk()`, and a
+  /// sample for its stack if the first of `values` is non-zero.
+  pub fn node<N: ProfileNode>(
+    &mut self,
+    path: &[&N],
+    values: &[i64],
+  ) -> io::Result<()> {
+    let node = *path.last().unwrap();
+    let name = node.name();
+    let name = if name.is_empty() {
+      "(anonymous)"
+    } else {
+      &name
+    };
+    let line = node.line();
+    let function_id = self.function(name, &node.file_name(), line)?;
+    self.location(node.id(), function_id, line)?;
+    if values[0] != 0 {
+      let mut location_ids = std::mem::take(&mut self.location_ids);
+      location_ids.clear();
+      location_ids.extend(path.iter().rev().map(|node| node.id()));
+      self.sample(&location_ids, values)?;
+      self.location_ids = location_ids;
+    }
+    Ok(())
+  }
+
+  /// Writes the string table and the profile's time span, and returns the
+  /// underlying writer.
+  pub fn finish(
+    mut self,
+    time_nanos: i64,
+    duration_nanos: i64,
+  ) -> io::Result<W> {
+    self.write_int(PROFILE_TIME_NANOS, time_nanos)?;
+    self.write_int(PROFILE_DURATION_NANOS, duration_nanos)?;
+    for s in std::mem::take(&mut self.string_table) {
+      self.message.extend_from_slice(s.as_bytes());
+      self.write_message(PROFILE_STRING_TABLE)?;
+    }
+    self.writer.flush()?;
+    Ok(self.writer)
+  }
+
+  fn value_type(&mut self, (type_, unit): (&str, &str)) {
+    let type_ = self.string(type_);
+    let unit = self.string(unit);
+    encode_field(&mut self.message, 1, type_ as u64);
+    encode_field(&mut self.message, 2, unit as u64);
+  }
+
+  fn write_int(&mut self, field: u32, value: i64) -> io::Result<()> {
+    let mut buf = Vec::with_capacity(16);
+    encode_field(&mut buf, field, value as u64);
+    self.writer.write_all(&buf)
+  }
+
+  /// Writes the contents of `self.message` as the length-delimited top-level
+  /// field `field`, and clears it.
+  fn write_message(&mut self, field: u32) -> io::Result<()> {
+    let mut header = Vec::with_capacity(16);
+    encode_varint(&mut header, (field << 3 | WIRE_LEN) as u64);
+    encode_varint(&mut header, self.message.len() as u64);
+    self.writer.write_all(&header)?;
+    self.writer.write_all(&self.message)?;
+    self.message.clear();
+    Ok(())
+  }
+}
+
+fn encode_varint(buf: &mut Vec<u8>, mut value: u64) {
+  while value >= 0x80 {
+    buf.push(value as u8 | 0x80);
+    value >>= 7;
+  }
+  buf.push(value as u8);
+}
+
+/// Encodes a varint field. Zero is the default value and is omitted.
+fn encode_field(buf: &mut Vec<u8>, field: u32, value: u64) {
+  if value != 0 {
+    encode_varint(buf, (field << 3 | WIRE_VARINT) as u64);
+    encode_varint(buf, value);
+  }
+}
+
+/// Appends `nested` to `buf` as a length-delimited field, and clears it.
+fn encode_nested(buf: &mut Vec<u8>, field: u32, nested: &mut Vec<u8>) {
+  encode_varint(buf, (field << 3 | WIRE_LEN) as u64);
+  encode_varint(buf, nested.len() as u64);
+  buf.append(nested);
+}
+
+#[cfg(test)]
+mod tests {
+  use super::*;
+
+  #[test]
+  fn test_profile_writer() {
+    let mut writer =
+      ProfileWriter::new(Vec::new(), &[("samples", "count")], ("cpu", "ns"), 7)
+        .unwrap();
+    let function = writer.function("f", "a.js", 3).unwrap();
+    assert_eq!(function, 1);
+    assert_eq!(writer.function("f", "a.js", 3).unwrap(), function);
+    writer.location(1, function, 4).unwrap();
+    writer.sample(&[1], &[300]).unwrap();
+    let bytes = writer.finish(0, 0).unwrap();
+    let mut expected = vec![
+      0x0a, 0x04, 0x08, 0x01, 0x10, 0x02, // sample_type { 1, 2 }
+      0x5a, 0x04, 0x08, 0x03, 0x10, 0x04, // period_type { 3, 4 }
+      0x60, 0x07, // period: 7
+      0x2a, 0x0a, 0x08, 0x01, 0x10, 0x05, 0x18, 0x05, 0x20, 0x06, 0x28, 0x03,
+      0x22, 0x08, 0x08, 0x01, 0x22, 0x04, 0x08, 0x01, 0x10, 0x04, 0x12, 0x07,
+      0x0a, 0x01, 0x01, 0x12, 0x02, 0xac, 0x02,
+    ];
+    for s in &["", "samples", "count", "cpu", "ns", "f", "a.js"] {
+      expected.push(0x32);
+      expected.push(s.len() as u8);
+      expected.extend_from_slice(s.as_bytes());
+    }
+    assert_eq!(bytes, expected);
+  }
+
+  struct Node(u64, Vec<Node>);
+
+  impl ProfileNode for Node {
+    fn child_at(&self, index: usize) -> Option<&Self> {
+      self.1.get(index)
+    }
+
+    fn name(&self) -> Cow<'_, str> {
+      Cow::Borrowed("")
+    }
+
+    fn file_name(&self) -> Cow<'_, str> {
+      Cow::Borrowed("a.js")
+    }
+
+    fn line(&self) -> i64 {
+      1
+    }
+
+    fn id(&self) -> u64 {
+      self.0
+    }
+  }
+
+  #[test]
+  fn test_walk() {
+    let root = Node(1, vec![Node(2, vec![Node(3, vec![])]), Node(4, vec![])]);
+    let mut paths = Vec::new();
+    walk(&root, |path| {
+      paths.push(path.iter().map(|node| node.id()).collect::<Vec<_>>())
+    });
+    assert_eq!(paths, vec![vec![1], vec![1, 2], vec![1, 2, 3], vec![1, 4]]);
+
+    let mut writer =
+      ProfileWriter::new(Vec::new(), &[("samples", "count")], ("cpu", "ns"), 1)
+        .unwrap();
+    walk(&root, |path| {
+      let hits = if path.len() == 3 { 5 } else { 0 };
+      writer.node(path, &[hits]).unwrap();
+    });
+    let bytes = writer.finish(0, 0).unwrap();
+    // The sample's stack goes from the leaf (3) to the root (1).
+    let sample = [0x12, 0x08, 0x0a, 0x03, 0x03, 0x02, 0x01, 0x12, 0x01, 0x05];
+    assert!(bytes.windows(sample.len()).any(|w| w == sample));
+    assert!(bytes.windows(11).any(|w| w == b"(anonymous)"));
+  }
+}
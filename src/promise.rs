@@ -3,6 +3,7 @@ use std::marker::PhantomData;
 use crate::support::MaybeBool;
 use crate::Context;
 use crate::Function;
+use crate::Global;
 use crate::HandleScope;
 use crate::Local;
 use crate::Promise;
@@ -26,6 +27,13 @@ extern "C" {
     context: *const Context,
     value: *const Value,
   ) -> MaybeBool;
+  fn v8__Promise__Resolver__SettleAll(
+    context: *const Context,
+    resolvers: *const *const PromiseResolver,
+    values: *const *const Value,
+    length: usize,
+    reject: bool,
+  ) -> usize;
   fn v8__Promise__State(this: *const Promise) -> PromiseState;
   fn v8__Promise__HasHandler(this: *const Promise) -> bool;
   fn v8__Promise__Result(this: *const Promise) -> *const Value;
@@ -189,6 +197,55 @@ impl PromiseResolver {
       .into()
     }
   }
+
+  /// Resolves the promise of every resolver in `resolutions` with the value
+  /// paired with it, then performs a microtask checkpoint so that the
+  /// reactions of all the promises run together. This is much cheaper than
+  /// resolving promises one by one when many I/O completions arrive at once.
+  ///
+  /// Like `resolve()`, this is ignored for promises that are no longer
+  /// pending. Returns the number of resolvers that were processed, which is
+  /// less than `resolutions.len()` only if execution was terminated; the
+  /// remaining promises are then left alone and no checkpoint is performed.
+  ///
+  /// The checkpoint drains the isolate's default microtask queue; contexts
+  /// created with their own `MicrotaskQueue` need it to be drained as well.
+  pub fn resolve_all(
+    scope: &mut HandleScope,
+    resolutions: &[(Global<PromiseResolver>, Local<Value>)],
+  ) -> usize {
+    Self::settle_all(scope, resolutions, false)
+  }
+
+  /// Like `resolve_all()`, but rejects the promises with the values instead.
+  pub fn reject_all(
+    scope: &mut HandleScope,
+    rejections: &[(Global<PromiseResolver>, Local<Value>)],
+  ) -> usize {
+    Self::settle_all(scope, rejections, true)
+  }
+
+  fn settle_all(
+    scope: &mut HandleScope,
+    settlements: &[(Global<PromiseResolver>, Local<Value>)],
+    reject: bool,
+  ) -> usize {
+    let mut resolvers = Vec::with_capacity(settlements.len());
+    let mut values = Vec::with_capacity(settlements.len());
+    for (resolver, value) in settlements {
+      resolvers.push(resolver.get(scope) as *const PromiseResolver);
+      values.push(&**value as *const Value);
+    }
+    unsafe {
+      v8__Promise__Resolver__SettleAll(
+        &*scope.get_current_context(),
+        resolvers.as_ptr(),
+        values.as_ptr(),
+        settlements.len(),
+        reject,
+      )
+    }
+  }
 }
 
 #[derive(Debug, Clone, Copy, PartialEq)]
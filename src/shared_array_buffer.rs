@@ -93,6 +93,11 @@ impl SharedArrayBuffer {
   /// If the allocator returns nullptr, then the function may cause GCs in the
   /// given isolate and re-try the allocation. If GCs do not help, then the
   /// function will crash with an out-of-memory error.
+  ///
+  /// The backing store can be grown or shrunk with
+  /// `BackingStore::reallocate()` as long as it is uniquely owned, i.e.
+  /// before a SharedArrayBuffer (visible to other threads) is created from
+  /// it.
   pub fn new_backing_store(
     scope: &mut Isolate,
     byte_length: usize,
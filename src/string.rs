@@ -71,6 +71,13 @@ extern "C" {
     length: int,
   ) -> *const String;
 
+  fn v8__String__NewExternalOneByte(
+    isolate: *mut Isolate,
+    buffer: *mut char,
+    length: usize,
+    free: unsafe extern "C" fn(*mut char, usize),
+  ) -> *const String;
+
   fn v8__String__NewExternalTwoByteStatic(
     isolate: *mut Isolate,
     buffer: *const u16,
@@ -287,6 +294,31 @@ impl String {
     }
   }
 
+  /// Creates a v8::String that takes ownership of `buffer` instead of copying
+  /// it into the V8 heap. `buffer` is freed when the string is garbage
+  /// collected. Must be Latin-1 or ASCII, not UTF-8 !
+  pub fn new_external_onebyte<'s>(
+    scope: &mut HandleScope<'s, ()>,
+    buffer: Box<[u8]>,
+  ) -> Option<Local<'s, String>> {
+    unsafe extern "C" fn free(data: *mut char, length: usize) {
+      let slice = slice::from_raw_parts_mut(data as *mut u8, length);
+      drop(Box::from_raw(slice));
+    }
+    let buffer_len = buffer.len();
+    let buffer = Box::into_raw(buffer) as *mut char;
+    unsafe {
+      scope.cast_local(|sd| {
+        v8__String__NewExternalOneByte(
+          sd.get_isolate_ptr(),
+          buffer,
+          buffer_len,
+          free,
+        )
+      })
+    }
+  }
+
   // Creates a v8::String from a `&'static [u16]`.
   pub fn new_external_twobyte_static<'s>(
     scope: &mut HandleScope<'s, ()>,
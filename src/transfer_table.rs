@@ -0,0 +1,176 @@
+// Copyright 2019-2021 the Deno authors. All rights reserved. MIT license.
+
+use crate::support::SharedRef;
+use crate::wasm::CompiledWasmModule;
+use crate::BackingStore;
+use crate::Exception;
+use crate::HandleScope;
+use crate::Local;
+use crate::SharedArrayBuffer;
+use crate::String;
+use crate::ValueDeserializerImpl;
+use crate::ValueSerializerImpl;
+use crate::WasmModuleObject;
+
+use std::sync::Arc;
+
+/// A TransferTable carries SharedArrayBuffers and compiled WebAssembly
+/// modules by reference alongside a serialized message, so that they can be
+/// shared between isolates (e.g. workers) without copying memory or
+/// recompiling code.
+///
+/// While serializing, the table records the backing store of every
+/// SharedArrayBuffer and the compiled module of every WebAssembly.Module it
+/// encounters, and V8 writes just their index into the message. The table is
+/// `Send`, so it can be moved to the thread that owns the receiving isolate,
+/// where the deserializer re-creates the objects from the recorded entries.
+///
+/// `&mut TransferTable` implements both ValueSerializerImpl and
+/// ValueDeserializerImpl, so it can be passed to `ValueSerializer::new()` and
+/// `ValueDeserializer::new()` directly. Embedders with their own delegate
+/// implementation can call `add_*()` and `get_*()` from their
+/// `get_shared_array_buffer_id()`, `get_wasm_module_transfer_id()`,
+/// `get_shared_array_buffer_from_id()` and `get_wasm_module_from_id()`
+/// methods instead.
+#[derive(Default)]
+pub struct TransferTable {
+  shared_array_buffers: Vec<SharedRef<BackingStore>>,
+  wasm_modules: Vec<Arc<CompiledWasmModule>>,
+}
+
+// std::shared_ptr<v8::BackingStore> uses an atomic reference count, and the
+// backing stores of SharedArrayBuffers are meant to be shared between
+// isolates running on different threads.
+unsafe impl Send for TransferTable {}
+
+impl TransferTable {
+  pub fn new() -> Self {
+    Default::default()
+  }
+
+  /// Records the backing store of `shared_array_buffer` and returns the id
+  /// that refers to it.
+  pub fn add_shared_array_buffer(
+    &mut self,
+    shared_array_buffer: Local<SharedArrayBuffer>,
+  ) -> u32 {
+    let id = self.shared_array_buffers.len() as u32;
+    self
+      .shared_array_buffers
+      .push(shared_array_buffer.get_backing_store());
+    id
+  }
+
+  /// Records the compiled module of `module` and returns the id that refers
+  /// to it.
+  pub fn add_wasm_module(&mut self, module: Local<WasmModuleObject>) -> u32 {
+    let id = self.wasm_modules.len() as u32;
+    self
+      .wasm_modules
+      .push(Arc::new(module.get_compiled_module()));
+    id
+  }
+
+  /// Creates a SharedArrayBuffer in the current isolate that shares its
+  /// memory with the SharedArrayBuffer recorded under `id`.
+  pub fn get_shared_array_buffer<'s>(
+    &self,
+    scope: &mut HandleScope<'s>,
+    id: u32,
+  ) -> Option<Local<'s, SharedArrayBuffer>> {
+    let backing_store = self.shared_array_buffers.get(id as usize)?;
+    Some(SharedArrayBuffer::with_backing_store(scope, backing_store))
+  }
+
+  /// Creates a WebAssembly.Module in the current isolate from the compiled
+  /// module recorded under `id`, without recompiling it.
+  pub fn get_wasm_module<'s>(
+    &self,
+    scope: &mut HandleScope<'s>,
+    id: u32,
+  ) -> Option<Local<'s, WasmModuleObject>> {
+    let compiled_module = self.wasm_modules.get(id as usize)?;
+    WasmModuleObject::from_compiled_module(scope, compiled_module)
+  }
+
+  /// The backing stores of all recorded SharedArrayBuffers, indexed by id.
+  pub fn shared_array_buffers(&self) -> &[SharedRef<BackingStore>] {
+    &self.shared_array_buffers
+  }
+
+  /// The compiled modules of all recorded WebAssembly modules, indexed by id.
+  pub fn wasm_modules(&self) -> &[Arc<CompiledWasmModule>] {
+    &self.wasm_modules
+  }
+
+  /// Returns true if nothing has been recorded in the table.
+  pub fn is_empty(&self) -> bool {
+    self.shared_array_buffers.is_empty() && self.wasm_modules.is_empty()
+  }
+
+  /// Removes all entries from the table, so that it can be reused for the
+  /// next message.
+  pub fn clear(&mut self) {
+    self.shared_array_buffers.clear();
+    self.wasm_modules.clear();
+  }
+}
+
+fn throw_error(scope: &mut HandleScope, message: &str) {
+  let message = String::new(scope, message).unwrap();
+  let exception = Exception::error(scope, message);
+  scope.throw_exception(exception);
+}
+
+impl<'t> ValueSerializerImpl for &'t mut TransferTable {
+  fn throw_data_clone_error<'s>(
+    &mut self,
+    scope: &mut HandleScope<'s>,
+    message: Local<'s, String>,
+  ) {
+    let exception = Exception::error(scope, message);
+    scope.throw_exception(exception);
+  }
+
+  fn get_shared_array_buffer_id<'s>(
+    &mut self,
+    _scope: &mut HandleScope<'s>,
+    shared_array_buffer: Local<'s, SharedArrayBuffer>,
+  ) -> Option<u32> {
+    Some(self.add_shared_array_buffer(shared_array_buffer))
+  }
+
+  fn get_wasm_module_transfer_id(
+    &mut self,
+    _scope: &mut HandleScope<'_>,
+    module: Local<WasmModuleObject>,
+  ) -> Option<u32> {
+    Some(self.add_wasm_module(module))
+  }
+}
+
+impl<'t> ValueDeserializerImpl for &'t mut TransferTable {
+  fn get_shared_array_buffer_from_id<'s>(
+    &mut self,
+    scope: &mut HandleScope<'s>,
+    transfer_id: u32,
+  ) -> Option<Local<'s, SharedArrayBuffer>> {
+    let shared_array_buffer = self.get_shared_array_buffer(scope, transfer_id);
+    if shared_array_buffer.is_none() {
+      throw_error(scope, "Invalid SharedArrayBuffer transfer id");
+    }
+    shared_array_buffer
+  }
+
+  fn get_wasm_module_from_id<'s>(
+    &mut self,
+    scope: &mut HandleScope<'s>,
+    clone_id: u32,
+  ) -> Option<Local<'s, WasmModuleObject>> {
+    if clone_id as usize >= self.wasm_modules.len() {
+      throw_error(scope, "Invalid WebAssembly.Module transfer id");
+      return None;
+    }
+    self.get_wasm_module(scope, clone_id)
+  }
+}
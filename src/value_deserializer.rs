@@ -1,4 +1,5 @@
 use crate::ArrayBuffer;
+use crate::BackingStore;
 use crate::Context;
 use crate::Exception;
 use crate::HandleScope;
@@ -13,6 +14,8 @@ use crate::WasmModuleObject;
 use crate::support::CxxVTable;
 use crate::support::FieldOffset;
 use crate::support::MaybeBool;
+use crate::support::SharedRef;
+use crate::support::UniqueRef;
 
 use std::ffi::c_void;
 use std::mem::MaybeUninit;
@@ -35,10 +38,12 @@ pub unsafe extern "C" fn v8__ValueDeserializer__Delegate__ReadHostObject(
     &mut crate::scope::CallbackScope::new(value_deserializer_heap.context);
   let value_deserializer_impl =
     value_deserializer_heap.value_deserializer_impl.as_mut();
-  match value_deserializer_impl.read_host_object(
-    scope,
-    &mut value_deserializer_heap.cxx_value_deserializer,
-  ) {
+  let mut value_deserializer = HostObjectDeserializer {
+    cxx_value_deserializer: &mut value_deserializer_heap.cxx_value_deserializer,
+    shared_data: value_deserializer_heap.shared_data.as_ref(),
+  };
+  match value_deserializer_impl.read_host_object(scope, &mut value_deserializer)
+  {
     None => std::ptr::null(),
     Some(x) => x.as_non_null().as_ptr(),
   }
@@ -208,6 +213,7 @@ pub struct ValueDeserializerHeap<'a, 's> {
   value_deserializer_impl: Box<dyn ValueDeserializerImpl + 'a>,
   cxx_value_deserializer: CxxValueDeserializer,
   cxx_value_deserializer_delegate: CxxValueDeserializerDelegate,
+  shared_data: Option<SharedRef<BackingStore>>,
   context: Local<'s, Context>,
 }
 
@@ -252,6 +258,12 @@ impl<'a, 's> Drop for ValueDeserializerHeap<'a, 's> {
 pub trait ValueDeserializerHelper {
   fn get_cxx_value_deserializer(&mut self) -> &mut CxxValueDeserializer;
 
+  /// Returns the input of the deserializer if it was created with
+  /// `ValueDeserializer::new_with_shared_data()`.
+  fn get_shared_data(&self) -> Option<&SharedRef<BackingStore>> {
+    None
+  }
+
   fn read_header(&mut self, context: Local<Context>) -> Option<bool> {
     unsafe {
       v8__ValueDeserializer__ReadHeader(
@@ -318,6 +330,36 @@ pub trait ValueDeserializerHelper {
     }
   }
 
+  /// Reads `length` raw bytes and returns them as a standalone BackingStore,
+  /// which can be passed to `ArrayBuffer::with_backing_store()`.
+  ///
+  /// If the deserializer was created with
+  /// `ValueDeserializer::new_with_shared_data()`, the backing store points
+  /// directly into the input's backing store and keeps a reference to it; no
+  /// data is copied. Otherwise the bytes are copied into a new allocation.
+  fn read_raw_bytes_as_backing_store(
+    &mut self,
+    length: usize,
+  ) -> Option<UniqueRef<BackingStore>> {
+    let shared_data = self.get_shared_data().cloned();
+    let bytes = self.read_raw_bytes(length)?;
+    match shared_data {
+      Some(shared_data) => unsafe {
+        let data = bytes.as_ptr() as *mut c_void;
+        let deleter_data = Box::into_raw(Box::new(shared_data));
+        Some(ArrayBuffer::new_backing_store_from_raw_parts(
+          data,
+          length,
+          shared_data_deleter_callback,
+          deleter_data as *mut c_void,
+        ))
+      },
+      None => Some(ArrayBuffer::new_backing_store_from_boxed_slice(
+        bytes.to_vec().into_boxed_slice(),
+      )),
+    }
+  }
+
   fn transfer_array_buffer(
     &mut self,
     transfer_id: u32,
@@ -343,12 +385,46 @@ impl<'a, 's> ValueDeserializerHelper for ValueDeserializerHeap<'a, 's> {
   fn get_cxx_value_deserializer(&mut self) -> &mut CxxValueDeserializer {
     &mut self.cxx_value_deserializer
   }
+
+  fn get_shared_data(&self) -> Option<&SharedRef<BackingStore>> {
+    self.shared_data.as_ref()
+  }
 }
 
 impl<'a, 's> ValueDeserializerHelper for ValueDeserializer<'a, 's> {
   fn get_cxx_value_deserializer(&mut self) -> &mut CxxValueDeserializer {
     &mut (*self.value_deserializer_heap).cxx_value_deserializer
   }
+
+  fn get_shared_data(&self) -> Option<&SharedRef<BackingStore>> {
+    self.value_deserializer_heap.shared_data.as_ref()
+  }
+}
+
+/// The ValueDeserializerHelper handed to `read_host_object()`. It borrows the
+/// parts of the ValueDeserializerHeap that aren't borrowed by the
+/// ValueDeserializerImpl itself.
+struct HostObjectDeserializer<'h> {
+  cxx_value_deserializer: &'h mut CxxValueDeserializer,
+  shared_data: Option<&'h SharedRef<BackingStore>>,
+}
+
+impl<'h> ValueDeserializerHelper for HostObjectDeserializer<'h> {
+  fn get_cxx_value_deserializer(&mut self) -> &mut CxxValueDeserializer {
+    self.cxx_value_deserializer
+  }
+
+  fn get_shared_data(&self) -> Option<&SharedRef<BackingStore>> {
+    self.shared_data
+  }
+}
+
+unsafe extern "C" fn shared_data_deleter_callback(
+  _data: *mut c_void,
+  _byte_length: usize,
+  deleter_data: *mut c_void,
+) {
+  drop(Box::from_raw(deleter_data as *mut SharedRef<BackingStore>))
 }
 
 /// ValueDeserializer is a stack object used as entry-point for an owned and
@@ -365,6 +441,52 @@ impl<'a, 's> ValueDeserializer<'a, 's> {
     scope: &mut HandleScope<'s>,
     value_deserializer_impl: Box<D>,
     data: &[u8],
+  ) -> Self {
+    unsafe { Self::new_impl(scope, value_deserializer_impl, data, None) }
+  }
+
+  /// Creates a deserializer that reads its input from a backing store and
+  /// holds a reference to it. Binary data read with
+  /// `ValueDeserializerHelper::read_raw_bytes_as_backing_store()` (usually
+  /// from `read_host_object()`) is then exposed to JavaScript without copying:
+  /// the resulting ArrayBuffers share the memory of `data`, which is kept
+  /// alive until the last of them is garbage collected.
+  ///
+  /// Combined with `ValueSerializerHelper::
+  /// set_treat_array_buffer_views_as_host_objects()` on the serializing end,
+  /// this makes it possible to load large binary payloads, including ones
+  /// from memory-mapped files (see
+  /// `ArrayBuffer::new_backing_store_from_file()`), without copying them. A
+  /// `Vec<u8>` can be turned into a backing store with
+  /// `ArrayBuffer::new_backing_store_from_boxed_slice()`.
+  ///
+  /// # Safety
+  ///
+  /// The memory of `data` must not be written to while the deserializer is
+  /// alive, e.g. through other ArrayBuffers or SharedArrayBuffers that use
+  /// the same backing store, possibly on other threads. Writes through the
+  /// ArrayBuffers created by this deserializer only touch the bytes that
+  /// have already been read, and are allowed.
+  pub unsafe fn new_with_shared_data<D>(
+    scope: &mut HandleScope<'s>,
+    value_deserializer_impl: Box<D>,
+    data: SharedRef<BackingStore>,
+  ) -> Self
+  where
+    D: ValueDeserializerImpl + 'a,
+  {
+    let bytes: &[u8] = match data.byte_length() {
+      0 => &[],
+      len => std::slice::from_raw_parts(data.data() as *const u8, len),
+    };
+    Self::new_impl(scope, value_deserializer_impl, bytes, Some(data))
+  }
+
+  unsafe fn new_impl<D: ValueDeserializerImpl + 'a>(
+    scope: &mut HandleScope<'s>,
+    value_deserializer_impl: Box<D>,
+    data: &[u8],
+    shared_data: Option<SharedRef<BackingStore>>,
   ) -> Self {
     // create dummy ValueDeserializerHeap and move to heap + pin to address
     let mut value_deserializer_heap = Box::pin(ValueDeserializerHeap {
@@ -379,24 +501,23 @@ impl<'a, 's> ValueDeserializer<'a, 's> {
           0: std::ptr::null(),
         },
       },
+      shared_data,
       context: scope.get_current_context(),
     });
 
-    unsafe {
-      v8__ValueDeserializer__Delegate__CONSTRUCT(core::mem::transmute(
-        &mut (*value_deserializer_heap).cxx_value_deserializer_delegate,
-      ));
-
-      v8__ValueDeserializer__CONSTRUCT(
-        core::mem::transmute(
-          &mut (*value_deserializer_heap).cxx_value_deserializer,
-        ),
-        scope.get_isolate_ptr(),
-        data.as_ptr(),
-        data.len(),
-        &mut (*value_deserializer_heap).cxx_value_deserializer_delegate,
-      );
-    };
+    v8__ValueDeserializer__Delegate__CONSTRUCT(core::mem::transmute(
+      &mut (*value_deserializer_heap).cxx_value_deserializer_delegate,
+    ));
+
+    v8__ValueDeserializer__CONSTRUCT(
+      core::mem::transmute(
+        &mut (*value_deserializer_heap).cxx_value_deserializer,
+      ),
+      scope.get_isolate_ptr(),
+      data.as_ptr(),
+      data.len(),
+      &mut (*value_deserializer_heap).cxx_value_deserializer_delegate,
+    );
 
     ValueDeserializer {
       value_deserializer_heap,
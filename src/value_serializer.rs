@@ -10,10 +10,9 @@ use crate::String;
 use crate::Value;
 use crate::WasmModuleObject;
 
-use std::alloc::alloc;
-use std::alloc::dealloc;
-use std::alloc::realloc;
+use std::alloc;
 use std::alloc::Layout;
+use std::mem::ManuallyDrop;
 use std::mem::MaybeUninit;
 
 use crate::support::CxxVTable;
@@ -21,6 +20,8 @@ use crate::support::FieldOffset;
 use crate::support::MaybeBool;
 
 use std::ffi::c_void;
+use std::io;
+use std::io::Write;
 use std::pin::Pin;
 
 // Must be == sizeof(v8::ValueSerializer::Delegate),
@@ -117,18 +118,34 @@ pub unsafe extern "C" fn v8__ValueSerializer__Delegate__ReallocateBufferMemory(
 ) -> *mut c_void {
   let base = ValueSerializerHeap::dispatch_mut(this);
 
-  let new_buffer = if old_buffer.is_null() {
-    let layout = Layout::from_size_align(size, 1).unwrap();
-    alloc(layout)
+  // The serializer buffer is managed as a `Vec<u8>` with a length of zero, so
+  // that `release()` can hand it out without copying, and a previously
+  // released (or freed) buffer can be recycled for the next message.
+  let mut buffer = if old_buffer.is_null() {
+    std::mem::take(&mut base.spare_buffer)
+  } else if base.buffer_size < size {
+    // V8 expects realloc() semantics: the bytes it has written so far must
+    // be kept, and only V8 knows how many there are. A `Vec` only keeps its
+    // first `len()` bytes when it grows, so the allocation is grown with the
+    // layout the `Vec` was allocated with instead.
+    let layout = Layout::array::<u8>(base.buffer_size).unwrap();
+    let new_buffer = alloc::realloc(old_buffer as *mut u8, layout, size);
+    if new_buffer.is_null() {
+      alloc::handle_alloc_error(Layout::array::<u8>(size).unwrap());
+    }
+    Vec::from_raw_parts(new_buffer, 0, size)
   } else {
-    let old_layout = Layout::from_size_align(base.buffer_size, 1).unwrap();
-    realloc(old_buffer as *mut _, old_layout, size)
+    Vec::from_raw_parts(old_buffer as *mut u8, 0, base.buffer_size)
   };
+  if buffer.capacity() < size {
+    buffer.reserve_exact(size);
+  }
 
-  base.buffer_size = size;
+  base.buffer_size = buffer.capacity();
+  *actual_size = buffer.capacity();
 
-  *actual_size = size;
-  new_buffer as *mut c_void
+  let mut buffer = ManuallyDrop::new(buffer);
+  buffer.as_mut_ptr() as *mut c_void
 }
 
 #[no_mangle]
@@ -138,8 +155,9 @@ pub unsafe extern "C" fn v8__ValueSerializer__Delegate__FreeBufferMemory(
 ) {
   let base = ValueSerializerHeap::dispatch_mut(this);
   if !buffer.is_null() {
-    let layout = Layout::from_size_align(base.buffer_size, 1).unwrap();
-    dealloc(buffer as *mut _, layout)
+    let buffer = Vec::from_raw_parts(buffer as *mut u8, 0, base.buffer_size);
+    base.buffer_size = 0;
+    base.recycle_buffer(buffer);
   };
 }
 
@@ -177,6 +195,10 @@ extern "C" {
   );
 
   fn v8__ValueSerializer__WriteHeader(this: *mut CxxValueSerializer);
+  fn v8__ValueSerializer__SetTreatArrayBufferViewsAsHostObjects(
+    this: *mut CxxValueSerializer,
+    mode: bool,
+  );
   fn v8__ValueSerializer__WriteValue(
     this: *mut CxxValueSerializer,
     context: Local<Context>,
@@ -270,6 +292,9 @@ pub struct ValueSerializerHeap<'a, 's> {
   cxx_value_serializer_delegate: CxxValueSerializerDelegate,
   cxx_value_serializer: CxxValueSerializer,
   buffer_size: usize,
+  spare_buffer: Vec<u8>,
+  treat_array_buffer_views_as_host_objects: bool,
+  isolate_ptr: *mut Isolate,
   context: Local<'s, Context>,
 }
 
@@ -282,6 +307,13 @@ impl<'a, 's> ValueSerializerHeap<'a, 's> {
     })
   }
 
+  fn get_cxx_value_serializer_offset() -> FieldOffset<CxxValueSerializer> {
+    let buf = std::mem::MaybeUninit::<Self>::uninit();
+    FieldOffset::from_ptrs(buf.as_ptr(), unsafe {
+      &(*buf.as_ptr()).cxx_value_serializer
+    })
+  }
+
   /// Starting from 'this' pointer a ValueSerializerHeap ref can be created
   pub unsafe fn dispatch(
     value_serializer_delegate: &'s CxxValueSerializerDelegate,
@@ -298,6 +330,27 @@ impl<'a, 's> ValueSerializerHeap<'a, 's> {
     Self::get_cxx_value_serializer_delegate_offset()
       .to_embedder_mut::<Self>(value_serializer_delegate)
   }
+
+  /// Sets the mode on the C++ serializer and remembers it, so that it can be
+  /// applied again after the serializer is reset.
+  fn set_array_buffer_views_mode(&mut self, mode: bool) {
+    self.treat_array_buffer_views_as_host_objects = mode;
+    unsafe {
+      v8__ValueSerializer__SetTreatArrayBufferViewsAsHostObjects(
+        &mut self.cxx_value_serializer,
+        mode,
+      )
+    };
+  }
+
+  /// Keeps `buffer` around so it can back the next serialization, unless a
+  /// buffer with a larger capacity is already being held.
+  fn recycle_buffer(&mut self, mut buffer: Vec<u8>) {
+    if buffer.capacity() > self.spare_buffer.capacity() {
+      buffer.clear();
+      self.spare_buffer = buffer;
+    }
+  }
 }
 
 impl<'a, 's> Drop for ValueSerializerHeap<'a, 's> {
@@ -318,6 +371,18 @@ pub trait ValueSerializerHelper {
     };
   }
 
+  /// Indicate whether to treat ArrayBufferView objects as host objects,
+  /// i.e. pass them to `ValueSerializerImpl::write_host_object()` instead of
+  /// serializing them with their underlying ArrayBuffer.
+  fn set_treat_array_buffer_views_as_host_objects(&mut self, mode: bool) {
+    unsafe {
+      v8__ValueSerializer__SetTreatArrayBufferViewsAsHostObjects(
+        self.get_cxx_value_serializer(),
+        mode,
+      )
+    };
+  }
+
   fn write_value(
     &mut self,
     context: Local<Context>,
@@ -380,18 +445,36 @@ impl ValueSerializerHelper for CxxValueSerializer {
   fn get_cxx_value_serializer(&mut self) -> &mut CxxValueSerializer {
     self
   }
+
+  fn set_treat_array_buffer_views_as_host_objects(&mut self, mode: bool) {
+    // A CxxValueSerializer is only ever created as part of a
+    // ValueSerializerHeap, which has to remember the mode.
+    let heap = unsafe {
+      ValueSerializerHeap::get_cxx_value_serializer_offset()
+        .to_embedder_mut::<ValueSerializerHeap>(self)
+    };
+    heap.set_array_buffer_views_mode(mode)
+  }
 }
 
 impl<'a, 's> ValueSerializerHelper for ValueSerializerHeap<'a, 's> {
   fn get_cxx_value_serializer(&mut self) -> &mut CxxValueSerializer {
     &mut self.cxx_value_serializer
   }
+
+  fn set_treat_array_buffer_views_as_host_objects(&mut self, mode: bool) {
+    self.set_array_buffer_views_mode(mode)
+  }
 }
 
 impl<'a, 's> ValueSerializerHelper for ValueSerializer<'a, 's> {
   fn get_cxx_value_serializer(&mut self) -> &mut CxxValueSerializer {
     &mut (*self.value_serializer_heap).cxx_value_serializer
   }
+
+  fn set_treat_array_buffer_views_as_host_objects(&mut self, mode: bool) {
+    (*self.value_serializer_heap).set_array_buffer_views_mode(mode)
+  }
 }
 
 pub struct ValueSerializer<'a, 's> {
@@ -422,6 +505,9 @@ impl<'a, 's> ValueSerializer<'a, 's> {
         },
       },
       buffer_size: 0,
+      spare_buffer: Vec::new(),
+      treat_array_buffer_views_as_host_objects: false,
+      isolate_ptr: scope.get_isolate_ptr(),
       context: scope.get_current_context(),
     });
 
@@ -447,19 +533,93 @@ impl<'a, 's> ValueSerializer<'a, 's> {
 
 impl<'a, 's> ValueSerializer<'a, 's> {
   pub fn release(mut self) -> Vec<u8> {
+    self.release_buffer()
+  }
+
+  /// Returns the serialized data, like `release()`, but keeps the serializer
+  /// alive and resets it so it can be used to serialize another message.
+  ///
+  /// Together with `recycle_buffer()` this makes it possible to serialize a
+  /// stream of messages without allocating a new serializer or a new buffer
+  /// for each one of them.
+  pub fn release_and_reset(&mut self) -> Vec<u8> {
+    let buffer = self.release_buffer();
+    self.reset();
+    buffer
+  }
+
+  /// Discards everything written so far and returns the serializer to its
+  /// initial state. The internal buffer is retained for the next message.
+  ///
+  /// V8 remembers every object it has written, so that repeated references
+  /// are encoded as back-references. Resetting clears that state, which makes
+  /// it safe to reuse a serializer for unrelated messages. Settings such as
+  /// `set_treat_array_buffer_views_as_host_objects()` are kept.
+  pub fn reset(&mut self) {
+    let heap = &mut *self.value_serializer_heap;
+    unsafe {
+      v8__ValueSerializer__DESTRUCT(&mut heap.cxx_value_serializer);
+      v8__ValueSerializer__CONSTRUCT(
+        &mut heap.cxx_value_serializer as *mut _ as *mut _,
+        heap.isolate_ptr,
+        &mut heap.cxx_value_serializer_delegate,
+      );
+    }
+    if heap.treat_array_buffer_views_as_host_objects {
+      heap.set_array_buffer_views_mode(true);
+    }
+  }
+
+  /// Hands a buffer, typically one previously returned by `release()` or
+  /// `release_and_reset()`, back to the serializer. Its allocation is reused
+  /// for the next message if it is larger than the buffer currently held.
+  /// Any data in the buffer is discarded.
+  pub fn recycle_buffer(&mut self, buffer: Vec<u8>) {
+    (*self.value_serializer_heap).recycle_buffer(buffer)
+  }
+
+  /// Returns the data serialized so far without resetting the serializer.
+  /// Values written afterwards continue the same stream: they may refer back
+  /// to objects written before, and concatenating all the returned segments
+  /// yields the same bytes `release()` would have returned.
+  ///
+  /// V8 addresses its output buffer by offset, so data can only be taken out
+  /// between two writes, not while `write_value()` runs. To bound peak memory
+  /// while serializing large state, write it as a sequence of values and take
+  /// (or flush) the buffer in between. The receiving end reads the values
+  /// back one by one with `read_value()`.
+  pub fn take_buffer(&mut self) -> Vec<u8> {
+    self.release_buffer()
+  }
+
+  /// Writes the data serialized so far to `writer`, then keeps serializing
+  /// into the same buffer, which is emptied rather than reallocated.
+  ///
+  /// See `take_buffer()` for how this can be used to stream a large message
+  /// to a file or an IPC channel in segments.
+  pub fn flush_to<W: Write>(&mut self, writer: &mut W) -> io::Result<usize> {
+    let buffer = self.release_buffer();
+    let result = writer.write_all(&buffer).map(|_| buffer.len());
+    self.recycle_buffer(buffer);
+    result
+  }
+
+  fn release_buffer(&mut self) -> Vec<u8> {
+    let heap = &mut *self.value_serializer_heap;
     unsafe {
       let mut size: usize = 0;
       let mut ptr: *mut u8 = &mut 0;
       v8__ValueSerializer__Release(
-        &mut (*self.value_serializer_heap).cxx_value_serializer,
+        &mut heap.cxx_value_serializer,
         &mut ptr,
         &mut size,
       );
-      Vec::from_raw_parts(
-        ptr as *mut u8,
-        size,
-        (*self.value_serializer_heap).buffer_size,
-      )
+      if heap.buffer_size == 0 {
+        // Nothing has been written, so V8 never allocated a buffer.
+        return Vec::new();
+      }
+      let capacity = std::mem::replace(&mut heap.buffer_size, 0);
+      Vec::from_raw_parts(ptr as *mut u8, size, capacity)
     }
   }
 
@@ -4,10 +4,12 @@ use crate::function::FunctionCallbackArguments;
 use crate::function::FunctionCallbackInfo;
 use crate::scope::CallbackScope;
 use crate::scope::HandleScope;
+use crate::support::Opaque;
 use crate::support::UnitType;
 use crate::Isolate;
 use crate::Local;
 use crate::Value;
+use crate::WasmModuleObject;
 use std::ptr::null;
 use std::ptr::null_mut;
 
@@ -62,6 +64,61 @@ impl Drop for WasmStreaming {
   }
 }
 
+/// Wrapper around a compiled WebAssembly module, which is potentially shared by
+/// different WasmModuleObjects, possibly in different isolates.
+pub struct CompiledWasmModule(*mut InternalCompiledWasmModule);
+
+// OK to implement Send and Sync because the compiled module (a
+// v8::internal::wasm::NativeModule) is designed to be shared between isolates
+// and threads.
+unsafe impl Send for CompiledWasmModule {}
+unsafe impl Sync for CompiledWasmModule {}
+
+#[repr(C)]
+struct InternalCompiledWasmModule(Opaque);
+
+impl CompiledWasmModule {
+  /// Returns the wire bytes, i.e. the original WebAssembly binary, that the
+  /// module was compiled from.
+  pub fn get_wire_bytes_ref(&self) -> &[u8] {
+    let mut length = 0;
+    unsafe {
+      let data = v8__CompiledWasmModule__GetWireBytesRef(self.0, &mut length);
+      std::slice::from_raw_parts(data, length)
+    }
+  }
+}
+
+impl Drop for CompiledWasmModule {
+  fn drop(&mut self) {
+    unsafe { v8__CompiledWasmModule__DELETE(self.0) }
+  }
+}
+
+impl WasmModuleObject {
+  /// Get the compiled module for this module object. The compiled module can
+  /// be shared by several module objects.
+  pub fn get_compiled_module(&self) -> CompiledWasmModule {
+    CompiledWasmModule(unsafe { v8__WasmModuleObject__GetCompiledModule(self) })
+  }
+
+  /// Efficiently re-create a WasmModuleObject, without recompiling, from
+  /// a CompiledWasmModule.
+  pub fn from_compiled_module<'s>(
+    scope: &mut HandleScope<'s>,
+    compiled_module: &CompiledWasmModule,
+  ) -> Option<Local<'s, WasmModuleObject>> {
+    unsafe {
+      scope.cast_local(|sd| {
+        v8__WasmModuleObject__FromCompiledModule(
+          sd.get_isolate_ptr(),
+          compiled_module.0,
+        )
+      })
+    }
+  }
+}
+
 pub(crate) fn trampoline<F>() -> extern "C" fn(*const FunctionCallbackInfo)
 where
   F: UnitType + Fn(&mut HandleScope, Local<Value>, WasmStreaming),
@@ -102,4 +159,18 @@ extern "C" {
     this: *mut WasmStreamingSharedPtr,
     exception: *const Value,
   );
+
+  fn v8__WasmModuleObject__GetCompiledModule(
+    this: *const WasmModuleObject,
+  ) -> *mut InternalCompiledWasmModule;
+  fn v8__WasmModuleObject__FromCompiledModule(
+    isolate: *mut Isolate,
+    compiled_module: *const InternalCompiledWasmModule,
+  ) -> *const WasmModuleObject;
+
+  fn v8__CompiledWasmModule__GetWireBytesRef(
+    this: *mut InternalCompiledWasmModule,
+    length: *mut usize,
+  ) -> *const u8;
+  fn v8__CompiledWasmModule__DELETE(this: *mut InternalCompiledWasmModule);
 }
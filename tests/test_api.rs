@@ -7,6 +7,7 @@ use std::convert::{Into, TryFrom, TryInto};
 use std::ffi::c_void;
 use std::hash::Hash;
 use std::ptr::NonNull;
+use std::rc::Rc;
 use std::sync::atomic::{AtomicUsize, Ordering};
 
 use rusty_v8 as v8;
@@ -381,6 +382,158 @@ fn microtasks() {
   }
 }
 
+#[test]
+fn microtask_queue() {
+  let _setup_guard = setup();
+  let isolate = &mut v8::Isolate::new(Default::default());
+  let policy = v8::MicrotasksPolicy::Explicit;
+  let queue1 = Rc::new(v8::MicrotaskQueue::new(isolate, policy));
+  let queue2 = Rc::new(v8::MicrotaskQueue::new(isolate, policy));
+  assert!(!queue1.is_running_microtasks());
+  assert_eq!(queue1.get_microtasks_scope_depth(), 0);
+
+  let scope = &mut v8::HandleScope::new(isolate);
+  let context1 = v8::Context::new_with_microtask_queue(scope, queue1.clone());
+  let context2 = v8::Context::new_with_microtask_queue(scope, queue2.clone());
+  for context in [context1, context2].iter() {
+    let scope = &mut v8::ContextScope::new(scope, *context);
+    eval(
+      scope,
+      "globalThis.ran = 0; Promise.resolve().then(() => ran++)",
+    )
+    .unwrap();
+    // Each context's promise reactions go to its own queue, so neither the
+    // isolate's default queue nor `eval` runs them.
+    scope.perform_microtask_checkpoint();
+    assert!(eval(scope, "ran === 0").unwrap().is_true());
+  }
+
+  queue1.perform_checkpoint(scope);
+  {
+    let scope = &mut v8::ContextScope::new(scope, context1);
+    assert!(eval(scope, "ran === 1").unwrap().is_true());
+  }
+  {
+    let scope = &mut v8::ContextScope::new(scope, context2);
+    assert!(eval(scope, "ran === 0").unwrap().is_true());
+
+    static CALL_COUNT: AtomicUsize = AtomicUsize::new(0);
+    let function = v8::Function::new(
+      scope,
+      |_: &mut v8::HandleScope,
+       _: v8::FunctionCallbackArguments,
+       _: v8::ReturnValue| {
+        CALL_COUNT.fetch_add(1, Ordering::SeqCst);
+      },
+    )
+    .unwrap();
+    queue2.enqueue_microtask(scope, function);
+    queue2.perform_checkpoint(scope);
+    assert!(eval(scope, "ran === 1").unwrap().is_true());
+    assert_eq!(CALL_COUNT.load(Ordering::SeqCst), 1);
+  }
+
+  // The contexts can outlive the embedder's references to their queues.
+  drop(queue1);
+  drop(queue2);
+  let scope = &mut v8::ContextScope::new(scope, context1);
+  eval(scope, "Promise.resolve().then(() => ran++)").unwrap();
+}
+
+#[test]
+fn microtask_queue_released_with_context() {
+  let _setup_guard = setup();
+  let mut isolate = v8::Isolate::new(Default::default());
+  let policy = v8::MicrotasksPolicy::Explicit;
+  let queue = Rc::new(v8::MicrotaskQueue::new(&mut isolate, policy));
+  {
+    let scope = &mut v8::HandleScope::new(&mut isolate);
+    for _ in 0..2 {
+      v8::Context::new_with_microtask_queue(scope, queue.clone());
+    }
+    assert_eq!(Rc::strong_count(&queue), 3);
+  }
+  // Once the contexts are collected, they no longer hold on to the queue.
+  isolate.low_memory_notification();
+  assert_eq!(Rc::strong_count(&queue), 1);
+
+  // A context that is still alive when the isolate is disposed releases its
+  // queue too.
+  {
+    let scope = &mut v8::HandleScope::new(&mut isolate);
+    let _context = v8::Context::new_with_microtask_queue(scope, queue.clone());
+    assert_eq!(Rc::strong_count(&queue), 2);
+  }
+  drop(isolate);
+  assert_eq!(Rc::strong_count(&queue), 1);
+}
+
+#[test]
+fn async_context_variable() {
+  let _setup_guard = setup();
+  let isolate = &mut v8::Isolate::new(Default::default());
+  isolate.set_microtasks_policy(v8::MicrotasksPolicy::Explicit);
+  let scope = &mut v8::HandleScope::new(isolate);
+  let context = v8::Context::new(scope);
+  let scope = &mut v8::ContextScope::new(scope, context);
+
+  let variable = v8::AsyncContextVariable::new(scope);
+  let other = v8::AsyncContextVariable::new(scope);
+  assert!(variable.get(scope).is_none());
+  scope.set_slot(variable.clone());
+  let function = v8::Function::new(
+    scope,
+    |scope: &mut v8::HandleScope,
+     _: v8::FunctionCallbackArguments,
+     mut rv: v8::ReturnValue| {
+      let variable = scope.get_slot::<v8::AsyncContextVariable>().unwrap();
+      if let Some(value) = variable.clone().get(scope) {
+        rv.set(value);
+      }
+    },
+  )
+  .unwrap();
+  let global = context.global(scope);
+  let name = v8::String::new(scope, "current").unwrap();
+  global.set(scope, name.into(), function.into());
+  eval(
+    scope,
+    r#"
+      globalThis.results = [];
+      globalThis.start = () =>
+        Promise.resolve()
+          .then(() => results.push(current()))
+          .then(async () => {
+            await null;
+            results.push(current());
+          });
+    "#,
+  )
+  .unwrap();
+
+  for i in 1..=2 {
+    let value = v8::Integer::new(scope, i).into();
+    variable.run(scope, value, |scope| {
+      let value = v8::Integer::new(scope, i * 10).into();
+      other.run(scope, value, |scope| {
+        assert!(variable
+          .get(scope)
+          .unwrap()
+          .strict_equals(v8::Integer::new(scope, i).into()));
+        eval(scope, "start()").unwrap();
+      });
+    });
+  }
+  // The previous async context is restored after `run()` returns.
+  assert!(variable.get(scope).is_none());
+  assert!(other.get(scope).is_none());
+  assert!(eval(scope, "current() === undefined").unwrap().is_true());
+
+  scope.perform_microtask_checkpoint();
+  let results = eval(scope, "results.join()").unwrap();
+  assert_eq!(results.to_rust_string_lossy(scope), "1,2,1,2");
+}
+
 #[test]
 fn get_isolate_from_handle() {
   extern "C" {
@@ -527,6 +680,241 @@ fn backing_store_segfault() {
   drop(shared_bs); // Error occurred here.
 }
 
+#[test]
+fn pool_allocator() {
+  let _setup_guard = setup();
+  let pool = v8::PoolAllocator::new();
+  pool.set_quota(Some(1 << 20));
+  let params =
+    v8::Isolate::create_params().array_buffer_allocator(pool.make_allocator());
+  let isolate = &mut v8::Isolate::new(params);
+  {
+    let scope = &mut v8::HandleScope::new(isolate);
+    let context = v8::Context::new(scope);
+    let scope = &mut v8::ContextScope::new(scope, context);
+
+    let before = pool.stats();
+    let result = eval(scope, "buffers = [new ArrayBuffer(1000)]; 0").unwrap();
+    assert!(result.is_number());
+    let stats = pool.stats();
+    assert_eq!(stats.live_bytes, before.live_bytes + 1000);
+    assert_eq!(stats.allocations, before.allocations + 1);
+    assert!(stats.peak_bytes >= stats.live_bytes);
+
+    let scope = &mut v8::TryCatch::new(scope);
+    assert!(eval(scope, "new ArrayBuffer(2 << 20)").is_none());
+    assert!(scope.has_caught());
+    assert_eq!(pool.stats().rejected_allocations, 1);
+  }
+}
+
+#[test]
+fn backing_store_reallocate() {
+  let _setup_guard = setup();
+  for pool in &[None, Some(v8::PoolAllocator::new())] {
+    let mut params = v8::Isolate::create_params();
+    if let Some(pool) = pool {
+      params = params.array_buffer_allocator(pool.make_allocator());
+    }
+    let isolate = &mut v8::Isolate::new(params);
+
+    let backing_store = v8::ArrayBuffer::new_backing_store(isolate, 4);
+    backing_store[3].set(42);
+    for &byte_length in &[100, 100_000, 3 << 20, 10] {
+      let backing_store = v8::ArrayBuffer::new_backing_store(isolate, 0);
+      let backing_store =
+        v8::BackingStore::reallocate(isolate, backing_store, byte_length);
+      assert_eq!(backing_store.byte_length(), byte_length);
+    }
+    let backing_store =
+      v8::BackingStore::reallocate(isolate, backing_store, 3 << 20);
+    assert_eq!(backing_store.byte_length(), 3 << 20);
+    assert_eq!(backing_store[3].get(), 42);
+    assert!(backing_store[4..].iter().all(|b| b.get() == 0));
+    let backing_store = v8::BackingStore::reallocate(isolate, backing_store, 8);
+    assert_eq!(backing_store.byte_length(), 8);
+    assert_eq!(backing_store[3].get(), 42);
+
+    let shared_backing_store =
+      v8::SharedArrayBuffer::new_backing_store(isolate, 16);
+    shared_backing_store[0].set(7);
+    let shared_backing_store =
+      v8::BackingStore::reallocate(isolate, shared_backing_store, 1 << 16);
+    assert!(shared_backing_store.is_shared());
+    assert_eq!(shared_backing_store[0].get(), 7);
+
+    let scope = &mut v8::HandleScope::new(isolate);
+    let context = v8::Context::new(scope);
+    let scope = &mut v8::ContextScope::new(scope, context);
+    let ab =
+      v8::ArrayBuffer::with_backing_store(scope, &backing_store.make_shared());
+    assert_eq!(ab.byte_length(), 8);
+    let sab = v8::SharedArrayBuffer::with_backing_store(
+      scope,
+      &shared_backing_store.make_shared(),
+    );
+    assert_eq!(sab.byte_length(), 1 << 16);
+  }
+}
+
+#[cfg(unix)]
+#[test]
+fn array_buffer_from_file() {
+  use std::io::Write;
+
+  let _setup_guard = setup();
+  let path = std::env::temp_dir()
+    .join(format!("rusty_v8_array_buffer_{}.bin", std::process::id()));
+  let contents = (0..10_000u32).map(|i| i as u8).collect::<Vec<u8>>();
+  std::fs::File::create(&path)
+    .unwrap()
+    .write_all(&contents)
+    .unwrap();
+  let file = std::fs::File::open(&path).unwrap();
+
+  let isolate = &mut v8::Isolate::new(Default::default());
+  {
+    let scope = &mut v8::HandleScope::new(isolate);
+    let context = v8::Context::new(scope);
+    let scope = &mut v8::ContextScope::new(scope, context);
+
+    let backing_store = unsafe {
+      v8::ArrayBuffer::new_backing_store_from_file(
+        &file,
+        5000,
+        100,
+        v8::FileMapMode::CopyOnWrite,
+        v8::FileMapAdvice::Sequential,
+      )
+    }
+    .unwrap()
+    .make_shared();
+    assert_eq!(backing_store.byte_length(), 100);
+    assert_eq!(backing_store[0].get(), contents[5000]);
+    let ab = v8::ArrayBuffer::with_backing_store(scope, &backing_store);
+    let global = context.global(scope);
+    let key = v8::String::new(scope, "ab").unwrap().into();
+    global.set(scope, key, ab.into());
+    let result = eval(scope, "new Uint8Array(ab).fill(7).length").unwrap();
+    assert_eq!(result.int32_value(scope), Some(100));
+    assert_eq!(backing_store[99].get(), 7);
+
+    let backing_store = unsafe {
+      v8::ArrayBuffer::new_backing_store_from_file(
+        &file,
+        0,
+        contents.len(),
+        v8::FileMapMode::ReadOnly,
+        v8::FileMapAdvice::Random,
+      )
+    }
+    .unwrap();
+    assert_eq!(backing_store[9999].get(), contents[9999]);
+
+    let backing_store = unsafe {
+      v8::ArrayBuffer::new_backing_store_from_file(
+        &file,
+        0,
+        0,
+        v8::FileMapMode::ReadOnly,
+        v8::FileMapAdvice::Normal,
+      )
+    }
+    .unwrap();
+    assert_eq!(backing_store.byte_length(), 0);
+  }
+
+  // Writes through a copy-on-write mapping never reach the file.
+  assert_eq!(std::fs::read(&path).unwrap(), contents);
+  std::fs::remove_file(&path).unwrap();
+}
+
+#[test]
+fn op_ring() {
+  let _setup_guard = setup();
+  let isolate = &mut v8::Isolate::new(Default::default());
+  let ring = v8::OpRing::new(isolate, 4, 8);
+  assert_eq!(ring.capacity(), 4);
+  assert!(ring.is_empty());
+  // A SharedArrayBuffer without a ring header is rejected.
+  let zeroed =
+    v8::SharedArrayBuffer::new_backing_store(isolate, 256).make_shared();
+  assert!(v8::OpRing::from_backing_store(zeroed).is_none());
+  {
+    let scope = &mut v8::HandleScope::new(isolate);
+    let context = v8::Context::new(scope);
+    let scope = &mut v8::ContextScope::new(scope, context);
+
+    let class = eval(scope, v8::OpRing::JS_SOURCE).unwrap();
+    let sab = ring.shared_array_buffer(scope);
+    let global = context.global(scope);
+    let key = v8::String::new(scope, "OpRing").unwrap().into();
+    global.set(scope, key, class);
+    let key = v8::String::new(scope, "sab").unwrap().into();
+    global.set(scope, key, sab.into());
+
+    // JavaScript produces, Rust consumes.
+    let pushed = eval(
+      scope,
+      r#"
+        ring = new OpRing(sab);
+        view = new DataView(sab);
+        let pushed = 0;
+        for (let i = 1; i <= 5; i++) {
+          const offset = ring.reserve();
+          if (offset < 0) break;
+          view.setUint32(offset, i, true);
+          ring.commit();
+          pushed++;
+        }
+        pushed
+      "#,
+    )
+    .unwrap();
+    assert_eq!(pushed.int32_value(scope), Some(4));
+    assert!(ring.is_empty());
+    eval(scope, "ring.flush()").unwrap();
+    assert_eq!(ring.len(), 4);
+    let mut ids = vec![];
+    let count = ring.drain(|record| {
+      assert_eq!(record.len(), 8);
+      ids.push(u32::from_le_bytes([
+        record[0], record[1], record[2], record[3],
+      ]));
+    });
+    assert_eq!(count, 4);
+    assert_eq!(ids, vec![1, 2, 3, 4]);
+    assert!(ring.is_empty());
+    let result = eval(scope, "ring.push(new Uint8Array([5]))").unwrap();
+    assert!(result.is_true());
+    eval(scope, "ring.flush()").unwrap();
+    assert_eq!(
+      ring.drain(|record| assert_eq!(record, &[5, 0, 0, 0, 0, 0, 0, 0])),
+      1
+    );
+
+    // Rust produces, JavaScript consumes.
+    let ring =
+      v8::OpRing::from_backing_store(ring.backing_store().clone()).unwrap();
+    for i in 0..4u8 {
+      assert!(ring.push(&[i, 1]));
+    }
+    assert!(!ring.push(&[9]));
+    let result = eval(
+      scope,
+      r#"
+        const bytes = new Uint8Array(sab);
+        const records = [];
+        const count = ring.drain((offset) => records.push(bytes[offset]));
+        `${count}:${records}`
+      "#,
+    )
+    .unwrap();
+    assert_eq!(result.to_rust_string_lossy(scope), "4:0,1,2,3");
+    assert!(ring.is_empty());
+  }
+}
+
 #[test]
 fn shared_array_buffer_allocator() {
   let alloc1 = v8::new_default_allocator().make_shared();
@@ -883,6 +1271,115 @@ fn request_interrupt_small_scripts() {
   }
 }
 
+#[test]
+fn request_interrupt_with() {
+  let _setup_guard = setup();
+  let handle;
+  {
+    let isolate = &mut v8::Isolate::new(Default::default());
+    handle = isolate.thread_safe_handle();
+    let scope = &mut v8::HandleScope::new(isolate);
+    let context = v8::Context::new(scope);
+    let scope = &mut v8::ContextScope::new(scope, context);
+
+    // More closures than fit in the preallocated queue, some of them too
+    // big to be stored inline.
+    let count = std::sync::Arc::new(AtomicUsize::new(0));
+    let threads = (0..4)
+      .map(|_| {
+        let handle = handle.clone();
+        let count = count.clone();
+        std::thread::spawn(move || {
+          for i in 0..25 {
+            let count = count.clone();
+            let padding = [i; 8];
+            assert!(handle.request_interrupt_with(move |isolate| {
+              assert!(!isolate.is_execution_terminating());
+              count.fetch_add(1 + padding[0] - i, Ordering::SeqCst);
+            }));
+          }
+        })
+      })
+      .collect::<Vec<_>>();
+    for thread in threads {
+      thread.join().unwrap();
+    }
+    eval(scope, "(function(x){return x;})(1);").unwrap();
+    assert_eq!(count.load(Ordering::SeqCst), 100);
+
+    // Outside JavaScript, queued closures run at the embedder's safepoints.
+    for _ in 0..3 {
+      let count = count.clone();
+      assert!(handle.request_interrupt_with(move |_| {
+        count.fetch_add(1, Ordering::SeqCst);
+      }));
+    }
+    assert_eq!(scope.run_queued_interrupts(), 3);
+    assert_eq!(scope.run_queued_interrupts(), 0);
+    assert_eq!(count.load(Ordering::SeqCst), 103);
+    eval(scope, "(function(x){return x;})(1);").unwrap();
+    assert_eq!(count.load(Ordering::SeqCst), 103);
+
+    let count2 = count.clone();
+    assert!(handle.request_interrupt_with(move |isolate| {
+      count2.fetch_add(1, Ordering::SeqCst);
+      isolate.terminate_execution();
+    }));
+    assert!(eval(scope, "for (;;) {}").is_none());
+    assert_eq!(count.load(Ordering::SeqCst), 104);
+    scope.cancel_terminate_execution();
+  }
+  // The isolate is gone.
+  assert!(!handle.request_interrupt_with(|_| unreachable!()));
+  assert!(!handle.terminate_execution());
+  assert!(!handle.is_execution_terminating());
+}
+
+#[test]
+fn cpu_budget() {
+  let _setup_guard = setup();
+  let isolate = &mut v8::Isolate::new(Default::default());
+  let scope = &mut v8::HandleScope::new(isolate);
+  let context = v8::Context::new(scope);
+  let scope = &mut v8::ContextScope::new(scope, context);
+
+  // Well within budget.
+  let guard = scope.start_cpu_budget(v8::CpuBudget {
+    cpu_limit: std::time::Duration::from_secs(10),
+    wall_limit: None,
+  });
+  eval(scope, "for (let i = 0; i < 1e6; i++) {}").unwrap();
+  let usage = guard.finish();
+  assert!(!usage.exceeded);
+  assert!(usage.cpu_time <= usage.wall_time);
+
+  // An infinite loop is terminated once the CPU time is used up.
+  let cpu_limit = std::time::Duration::from_millis(100);
+  let guard = scope.start_cpu_budget(v8::CpuBudget {
+    cpu_limit,
+    wall_limit: None,
+  });
+  assert!(eval(scope, "for (;;) {}").is_none());
+  let usage = guard.finish();
+  assert!(usage.exceeded);
+  assert!(usage.cpu_time >= cpu_limit);
+  assert!(scope.is_execution_terminating());
+  scope.cancel_terminate_execution();
+  eval(scope, "1 + 1").expect("execution should be possible again");
+
+  // Time spent outside JavaScript only counts toward the wall limit.
+  let guard = scope.start_cpu_budget(v8::CpuBudget {
+    cpu_limit: std::time::Duration::from_secs(10),
+    wall_limit: Some(std::time::Duration::from_millis(100)),
+  });
+  std::thread::sleep(std::time::Duration::from_millis(200));
+  assert!(eval(scope, "for (;;) {}").is_none());
+  let usage = guard.finish();
+  assert!(usage.exceeded);
+  assert!(usage.cpu_time < std::time::Duration::from_secs(10));
+  scope.cancel_terminate_execution();
+}
+
 #[test]
 fn add_message_listener() {
   let _setup_guard = setup();
@@ -1197,6 +1694,149 @@ fn json() {
   }
 }
 
+#[test]
+fn json_utf8() {
+  let _setup_guard = setup();
+  let isolate = &mut v8::Isolate::new(Default::default());
+  {
+    let scope = &mut v8::HandleScope::new(isolate);
+    let context = v8::Context::new(scope);
+    let scope = &mut v8::ContextScope::new(scope, context);
+
+    let json = "{\"a\": \"\u{e9}\u{1f600}\"}";
+    let value = v8::json::parse_utf8(scope, json.as_bytes()).unwrap();
+    let mut buffer = b"prefix:".to_vec();
+    let written = v8::json::stringify_into(scope, value, &mut buffer).unwrap();
+    assert_eq!(written, buffer.len() - 7);
+    assert_eq!(buffer, "prefix:{\"a\":\"\u{e9}\u{1f600}\"}".as_bytes());
+
+    let ascii = b"[1, {\"b\": true}]".to_vec().into_boxed_slice();
+    let value = v8::json::parse_utf8_owned(scope, ascii).unwrap();
+    let mut buffer = vec![];
+    v8::json::stringify_into(scope, value, &mut buffer).unwrap();
+    assert_eq!(buffer, b"[1,{\"b\":true}]");
+
+    let non_ascii = "[\"\u{fc}\"]".as_bytes().to_vec().into_boxed_slice();
+    let value = v8::json::parse_utf8_owned(scope, non_ascii).unwrap();
+    let mut buffer = vec![];
+    v8::json::stringify_into(scope, value, &mut buffer).unwrap();
+    assert_eq!(buffer, "[\"\u{fc}\"]".as_bytes());
+
+    let scope = &mut v8::TryCatch::new(scope);
+    assert!(v8::json::parse_utf8(scope, b"{").is_none());
+    assert!(scope.has_caught());
+  }
+}
+
+#[test]
+fn convert_struct() {
+  use std::collections::HashMap;
+  use v8::convert::FromV8;
+  use v8::convert::ToV8;
+
+  v8::v8_enum! {
+    #[derive(Clone, Debug, PartialEq)]
+    enum Kind {
+      Circle,
+      Square,
+    }
+  }
+
+  v8::v8_struct! {
+    #[derive(Clone, Debug, PartialEq)]
+    struct Shape {
+      kind: Kind,
+      id: u32,
+      offset: i32,
+      size: f64,
+      visible: bool,
+      label: String,
+      parent: Option<u32>,
+      points: Vec<f64>,
+      attributes: HashMap<String, String>,
+    }
+  }
+
+  let _setup_guard = setup();
+  let isolate = &mut v8::Isolate::new(Default::default());
+  {
+    let scope = &mut v8::HandleScope::new(isolate);
+    let context = v8::Context::new(scope);
+    let scope = &mut v8::ContextScope::new(scope, context);
+
+    let mut attributes = HashMap::new();
+    attributes.insert("color".to_string(), "red".to_string());
+    let shape = Shape {
+      kind: Kind::Square,
+      id: 7,
+      offset: -3,
+      size: 1.5,
+      visible: true,
+      label: "\u{e9}".to_string(),
+      parent: None,
+      points: vec![0.5, 1.0],
+      attributes,
+    };
+    for _ in 0..2 {
+      let value = shape.to_v8(scope).unwrap();
+      let json = v8::json::stringify(scope, value).unwrap();
+      assert_eq!(
+        json.to_rust_string_lossy(scope),
+        "{\"kind\":\"Square\",\"id\":7,\"offset\":-3,\"size\":1.5,\
+         \"visible\":true,\"label\":\"\u{e9}\",\"parent\":null,\
+         \"points\":[0.5,1],\"attributes\":{\"color\":\"red\"}}"
+      );
+      assert_eq!(Shape::from_v8(scope, value), Some(shape.clone()));
+    }
+
+    let value = eval(
+      scope,
+      "({ kind: 'Circle', id: 1, offset: 2, size: 3, visible: false, \
+         label: '', points: [], attributes: {}, extra: 1 })",
+    )
+    .unwrap();
+    let shape = Shape::from_v8(scope, value).unwrap();
+    assert_eq!(shape.kind, Kind::Circle);
+    assert_eq!(shape.parent, None);
+    assert_eq!(shape.size, 3.0);
+
+    // Strings that aren't internalized, and integer keys, work too.
+    let value = eval(
+      scope,
+      "({ kind: ['Squ', 'are'].join(''), id: 1, offset: 2, size: 3, \
+         visible: false, label: '', points: [], attributes: { 1: 'one' } })",
+    )
+    .unwrap();
+    let shape = Shape::from_v8(scope, value).unwrap();
+    assert_eq!(shape.kind, Kind::Square);
+    assert_eq!(shape.attributes.get("1").map(|s| s.as_str()), Some("one"));
+
+    // Type mismatches are not coerced.
+    let value = eval(scope, "({ kind: 'Triangle' })").unwrap();
+    assert!(Shape::from_v8(scope, value).is_none());
+    let value: v8::Local<v8::Value> =
+      v8::String::new(scope, "7").unwrap().into();
+    assert!(u32::from_v8(scope, value).is_none());
+    let value: v8::Local<v8::Value> = v8::Integer::new(scope, -1).into();
+    assert!(u32::from_v8(scope, value).is_none());
+    assert_eq!(i32::from_v8(scope, value), Some(-1));
+
+    // Arrays are read in chunks, so a sparse array's length doesn't decide
+    // how much is allocated.
+    let value = eval(scope, "Array.from({ length: 3000 }, (_, i) => i)");
+    let elements = Vec::<u32>::from_v8(scope, value.unwrap()).unwrap();
+    assert_eq!(elements, (0..3000).collect::<Vec<_>>());
+    let value = eval(scope, "const a = [1]; a.length = 2 ** 32 - 1; a");
+    assert!(Vec::<u32>::from_v8(scope, value.unwrap()).is_none());
+
+    // Getters that throw make the conversion fail.
+    let scope = &mut v8::TryCatch::new(scope);
+    let value = eval(scope, "({ get kind() { throw 1 } })").unwrap();
+    assert!(Shape::from_v8(scope, value).is_none());
+    assert!(scope.has_caught());
+  }
+}
+
 #[test]
 fn no_internal_field() {
   let _setup_guard = setup();
@@ -1795,6 +2435,63 @@ fn promise_rejected() {
     assert_eq!(result.to_rust_string_lossy(scope), "test".to_string());
   }
 }
+
+#[test]
+fn promise_resolve_all() {
+  let _setup_guard = setup();
+  let isolate = &mut v8::Isolate::new(Default::default());
+  isolate.set_microtasks_policy(v8::MicrotasksPolicy::Explicit);
+  {
+    let scope = &mut v8::HandleScope::new(isolate);
+    let context = v8::Context::new(scope);
+    let scope = &mut v8::ContextScope::new(scope, context);
+    let track = eval(
+      scope,
+      r#"
+        globalThis.results = [];
+        (p) => p.then((v) => results.push(v), (e) => results.push(`!${e}`))
+      "#,
+    )
+    .unwrap();
+    let track = v8::Local::<v8::Function>::try_from(track).unwrap();
+    let recv = v8::undefined(scope).into();
+    let resolvers = (0..3)
+      .map(|_| {
+        let resolver = v8::PromiseResolver::new(scope).unwrap();
+        let promise = resolver.get_promise(scope);
+        track.call(scope, recv, &[promise.into()]).unwrap();
+        v8::Global::new(scope, resolver)
+      })
+      .collect::<Vec<_>>();
+
+    let resolutions = resolvers[..2]
+      .iter()
+      .enumerate()
+      .map(|(i, resolver)| {
+        (resolver.clone(), v8::Integer::new(scope, i as i32).into())
+      })
+      .collect::<Vec<_>>();
+    assert_eq!(v8::PromiseResolver::resolve_all(scope, &resolutions), 2);
+    // The reactions ran in the checkpoint that followed the resolutions.
+    let results = eval(scope, "results.join()").unwrap();
+    assert_eq!(results.to_rust_string_lossy(scope), "0,1");
+
+    let rejections = resolvers
+      .iter()
+      .map(|resolver| {
+        let value = v8::String::new(scope, "x").unwrap();
+        (resolver.clone(), value.into())
+      })
+      .collect::<Vec<_>>();
+    assert_eq!(v8::PromiseResolver::reject_all(scope, &rejections), 3);
+    // Only the pending promise is rejected.
+    let results = eval(scope, "results.join()").unwrap();
+    assert_eq!(results.to_rust_string_lossy(scope), "0,1,!x");
+    let promise = resolvers[0].get(scope).get_promise(scope);
+    assert_eq!(promise.state(), v8::PromiseState::Fulfilled);
+  }
+}
+
 #[test]
 fn proxy() {
   let _setup_guard = setup();
@@ -2063,8 +2760,66 @@ fn promise_hook() {
   }
 }
 
+#[cfg(feature = "promise_hooks")]
 #[test]
-fn allow_atomics_wait() {
+fn context_promise_hooks() {
+  let _setup_guard = setup();
+  let isolate = &mut v8::Isolate::new(Default::default());
+  isolate.set_microtasks_policy(v8::MicrotasksPolicy::Explicit);
+  let scope = &mut v8::HandleScope::new(isolate);
+  let context = v8::Context::new(scope);
+  let scope = &mut v8::ContextScope::new(scope, context);
+  let hooks = eval(
+    scope,
+    r#"
+      globalThis.events = [];
+      [
+        (promise, parent) => events.push(parent ? "init+" : "init"),
+        (promise) => events.push("before"),
+        (promise) => events.push("after"),
+        (promise) => events.push("resolve"),
+      ]
+    "#,
+  )
+  .unwrap();
+  let hooks = v8::Local::<v8::Array>::try_from(hooks).unwrap();
+  let hooks = (0..4)
+    .map(|i| {
+      let hook = hooks.get_index(scope, i).unwrap();
+      v8::Local::<v8::Function>::try_from(hook).unwrap()
+    })
+    .collect::<Vec<_>>();
+
+  // Only the resolve hook.
+  context.set_promise_hooks(None, None, None, Some(hooks[3]));
+  eval(scope, "Promise.resolve(1).then(() => {})").unwrap();
+  scope.perform_microtask_checkpoint();
+  let events = eval(scope, "events.splice(0).join()").unwrap();
+  assert_eq!(events.to_rust_string_lossy(scope), "resolve,resolve");
+
+  context.set_promise_hooks(
+    Some(hooks[0]),
+    Some(hooks[1]),
+    Some(hooks[2]),
+    None,
+  );
+  eval(scope, "Promise.resolve(1).then(() => {})").unwrap();
+  scope.perform_microtask_checkpoint();
+  let events = eval(scope, "events.splice(0).join()").unwrap();
+  assert_eq!(
+    events.to_rust_string_lossy(scope),
+    "init,init+,before,after"
+  );
+
+  context.set_promise_hooks(None, None, None, None);
+  eval(scope, "Promise.resolve(1).then(() => {})").unwrap();
+  scope.perform_microtask_checkpoint();
+  let events = eval(scope, "events.length").unwrap();
+  assert_eq!(events.int32_value(scope), Some(0));
+}
+
+#[test]
+fn allow_atomics_wait() {
   let _setup_guard = setup();
   let isolate = &mut v8::Isolate::new(Default::default());
   for allow in &[false, true, false] {
@@ -2095,6 +2850,97 @@ fn allow_atomics_wait() {
   }
 }
 
+#[test]
+fn atomics_wait_callback() {
+  #[derive(Default)]
+  struct Waits {
+    events: std::sync::Mutex<Vec<v8::AtomicsWaitEvent>>,
+    // The wake handle of an ongoing wait without a timeout.
+    wake_handle: std::sync::Mutex<Option<usize>>,
+  }
+
+  extern "C" fn callback(
+    event: v8::AtomicsWaitEvent,
+    _array_buffer: v8::Local<v8::SharedArrayBuffer>,
+    offset_in_bytes: usize,
+    _value: i64,
+    timeout_in_ms: f64,
+    wake_handle: *mut v8::AtomicsWaitWakeHandle,
+    data: *mut std::ffi::c_void,
+  ) {
+    assert_eq!(offset_in_bytes, 4);
+    let waits = unsafe { &*(data as *const Waits) };
+    waits.events.lock().unwrap().push(event);
+    let mut handle = waits.wake_handle.lock().unwrap();
+    *handle = match event {
+      v8::AtomicsWaitEvent::StartWait if timeout_in_ms.is_infinite() => {
+        assert!(!wake_handle.is_null());
+        Some(wake_handle as usize)
+      }
+      _ => None,
+    };
+  }
+
+  let _setup_guard = setup();
+  let isolate = &mut v8::Isolate::new(Default::default());
+  isolate.set_allow_atomics_wait(true);
+  let waits = std::sync::Arc::new(Waits::default());
+  let data = &*waits as *const Waits as *mut std::ffi::c_void;
+  isolate.set_atomics_wait_callback(Some(callback), data);
+
+  let scope = &mut v8::HandleScope::new(isolate);
+  let context = v8::Context::new(scope);
+  let scope = &mut v8::ContextScope::new(scope, context);
+  let mut wait = |source: &str| {
+    let result = eval(scope, source).unwrap();
+    let result = result.to_rust_string_lossy(scope);
+    (result, std::mem::take(&mut *waits.events.lock().unwrap()))
+  };
+
+  wait("var a = new Int32Array(new SharedArrayBuffer(8))");
+  assert_eq!(
+    wait("Atomics.wait(a, 1, 0, 1)"),
+    (
+      "timed-out".to_owned(),
+      vec![
+        v8::AtomicsWaitEvent::StartWait,
+        v8::AtomicsWaitEvent::TimedOut
+      ]
+    )
+  );
+  assert_eq!(
+    wait("Atomics.wait(a, 1, 1)"),
+    (
+      "not-equal".to_owned(),
+      vec![
+        v8::AtomicsWaitEvent::StartWait,
+        v8::AtomicsWaitEvent::NotEqual
+      ]
+    )
+  );
+
+  // A wait without a timeout can be stopped from another thread.
+  let waker = {
+    let waits = waits.clone();
+    std::thread::spawn(move || loop {
+      if let Some(handle) = *waits.wake_handle.lock().unwrap() {
+        unsafe { &*(handle as *const v8::AtomicsWaitWakeHandle) }.wake();
+        return;
+      }
+      std::thread::sleep(std::time::Duration::from_millis(1));
+    })
+  };
+  let (_, events) = wait("Atomics.wait(a, 1, 0)");
+  assert_eq!(
+    events,
+    vec![
+      v8::AtomicsWaitEvent::StartWait,
+      v8::AtomicsWaitEvent::APIStopped
+    ]
+  );
+  waker.join().unwrap();
+}
+
 fn mock_script_origin<'s>(
   scope: &mut v8::HandleScope<'s>,
   resource_name_: &str,
@@ -2622,6 +3468,51 @@ fn array_buffer_view() {
   }
 }
 
+#[test]
+fn array_buffer_view_get_contents() {
+  let _setup_guard = setup();
+  let isolate = &mut v8::Isolate::new(Default::default());
+  {
+    let scope = &mut v8::HandleScope::new(isolate);
+    let context = v8::Context::new(scope);
+    let scope = &mut v8::ContextScope::new(scope, context);
+
+    // Small typed arrays start out on the V8 heap.
+    let view: v8::Local<v8::ArrayBufferView> = eval(
+      scope,
+      "view = new Uint8Array([1, 2, 3, 4]).subarray(1, 3); view",
+    )
+    .unwrap()
+    .try_into()
+    .unwrap();
+    assert_eq!(unsafe { view.get_contents(scope) }.unwrap(), &[2, 3]);
+    unsafe { view.get_contents_mut(scope) }.unwrap()[0] = 42;
+    let result = eval(scope, "view.buffer.byteLength + ':' + view").unwrap();
+    assert_eq!(result.to_rust_string_lossy(scope), "4:42,3");
+
+    let view: v8::Local<v8::ArrayBufferView> =
+      eval(scope, "new Uint8Array(new ArrayBuffer(0))")
+        .unwrap()
+        .try_into()
+        .unwrap();
+    assert_eq!(unsafe { view.get_contents(scope) }.unwrap(), &[]);
+
+    let view: v8::Local<v8::ArrayBufferView> = eval(scope, "new Uint8Array(8)")
+      .unwrap()
+      .try_into()
+      .unwrap();
+    view.buffer(scope).unwrap().detach();
+    assert_eq!(unsafe { view.get_contents(scope) }.unwrap(), &[]);
+
+    let view: v8::Local<v8::ArrayBufferView> =
+      eval(scope, "new Uint8Array(new SharedArrayBuffer(8))")
+        .unwrap()
+        .try_into()
+        .unwrap();
+    assert!(unsafe { view.get_contents(scope) }.is_none());
+  }
+}
+
 #[test]
 fn snapshot_creator() {
   let _setup_guard = setup();
@@ -3676,6 +4567,63 @@ fn inspector_schedule_pause_on_next_statement() {
   assert_ne!(client.count_generate_unique_id, 0);
 }
 
+#[test]
+fn inspector_batching_channel() {
+  let _setup_guard = setup();
+  let isolate = &mut v8::Isolate::new(Default::default());
+
+  use v8::inspector::*;
+  let mut client = ClientCounter::new();
+  let mut inspector = V8Inspector::create(isolate, &mut client);
+
+  let scope = &mut v8::HandleScope::new(isolate);
+  let context = v8::Context::new(scope);
+  let scope = &mut v8::ContextScope::new(scope, context);
+
+  let (sender, receiver) = std::sync::mpsc::channel();
+  let mut channel = BatchingChannel::new(
+    64,
+    spawn_utf8_encoder(move |batch| sender.send(batch).unwrap()),
+  );
+  let state = b"{}";
+  let state_view = StringView::from(&state[..]);
+  let mut session = inspector.connect(1, &mut channel, state_view);
+
+  let name = b"";
+  let name_view = StringView::from(&name[..]);
+  inspector.context_created(context, 1, name_view);
+
+  let message = br#"{"id":1,"method":"Debugger.enable"}"#;
+  session.dispatch_protocol_message(StringView::from(&message[..]));
+  let batch = receiver.recv().unwrap();
+  let (call_id, response) = batch.last().unwrap();
+  assert_eq!(*call_id, Some(1));
+  assert!(response.contains(r#""id":1"#));
+
+  let reason = StringView::from(&b""[..]);
+  let detail = StringView::from(&b""[..]);
+  session.schedule_pause_on_next_statement(reason, detail);
+  let r = eval(scope, "1+2").unwrap();
+  assert!(r.is_number());
+
+  // The three notifications sent around the pause arrive batched: V8 flushes
+  // when it pauses, and the embedder flushes once the script is done.
+  channel.flush();
+  let mut batches = Vec::new();
+  let mut messages = Vec::new();
+  while messages.len() < 3 {
+    let batch = receiver.recv().unwrap();
+    batches.push(batch.len());
+    messages.extend(batch);
+  }
+  assert!(batches.len() < 3);
+  assert_eq!(messages.len(), 3);
+  assert!(messages.iter().all(|(call_id, _)| call_id.is_none()));
+  assert!(messages
+    .iter()
+    .any(|(_, message)| message.contains("Debugger.paused")));
+}
+
 #[test]
 fn inspector_console_api_message() {
   let _setup_guard = setup();
@@ -3784,6 +4732,371 @@ fn take_heap_snapshot() {
   }
 }
 
+#[test]
+fn cpu_profiler() {
+  let _setup_guard = setup();
+  let isolate = &mut v8::Isolate::new(Default::default());
+  let profiler = v8::CpuProfiler::new(
+    isolate,
+    v8::CpuProfilingNamingMode::DebugNaming,
+    v8::CpuProfilingLoggingMode::LazyLogging,
+  );
+  profiler.set_sampling_interval(100).unwrap();
+  {
+    let scope = &mut v8::HandleScope::new(isolate);
+    let context = v8::Context::new(scope);
+    let scope = &mut v8::ContextScope::new(scope, context);
+    let title = v8::String::new(scope, "test").unwrap();
+    let status = profiler.start_profiling(title, &Default::default());
+    assert_eq!(status, Some(v8::CpuProfilingStatus::Started));
+    let source = r#"
+      function busyLoop() {
+        const end = Date.now() + 200;
+        let n = 0;
+        while (Date.now() < end) n++;
+        return n;
+      }
+      busyLoop();
+    "#;
+    eval(scope, source).unwrap();
+    let other = v8::String::new(scope, "other").unwrap();
+    assert!(profiler.stop_profiling(other).is_none());
+    let profile = profiler.stop_profiling(title).unwrap();
+    let title = profile.title(scope).unwrap();
+    assert_eq!(title.to_rust_string_lossy(scope), "test");
+    assert!(profile.end_time().unwrap() > profile.start_time().unwrap());
+
+    let root = profile.top_down_root(scope).unwrap();
+    assert_eq!(root.function_name(), "(root)");
+    assert!(root.parent().is_none());
+    let mut busy_loop_hits = 0;
+    root.walk(|path| {
+      let node = path.last().unwrap();
+      if node.function_name() == "busyLoop" {
+        assert_eq!(node.line_number(), 2);
+        assert_eq!(
+          path[path.len() - 2].node_id(),
+          node.parent().unwrap().node_id()
+        );
+        busy_loop_hits += node.hit_count();
+      }
+    });
+    assert!(busy_loop_hits > 0);
+    let count = profile.samples_count().unwrap();
+    assert!(count > 0);
+    let last = profile.sample_timestamp(count - 1).unwrap();
+    assert!(last <= profile.end_time().unwrap());
+    assert!(profile.sample(scope, count - 1).is_some());
+
+    let mut cpuprofile = Vec::new();
+    profile.write_cpuprofile(scope, &mut cpuprofile).unwrap();
+    let json = std::str::from_utf8(&cpuprofile).unwrap();
+    let json = v8::String::new(scope, json).unwrap();
+    let json = v8::json::parse(scope, json).unwrap();
+    let global = context.global(scope);
+    let name = v8::String::new(scope, "profile").unwrap();
+    global.set(scope, name.into(), json);
+    let result = eval(
+      scope,
+      r#"
+        profile.nodes[0].callFrame.functionName === "(root)" &&
+        profile.nodes.some((n) => n.callFrame.functionName === "busyLoop") &&
+        profile.samples.length === profile.timeDeltas.length
+      "#,
+    )
+    .unwrap();
+    assert!(result.is_true());
+
+    let mut pprof = Vec::new();
+    profile.write_pprof(scope, &mut pprof).unwrap();
+    assert!(pprof.windows(8).any(|w| w == b"busyLoop"));
+  }
+}
+
+#[test]
+fn cpu_profiler_outlives_isolate() {
+  let _setup_guard = setup();
+  let mut isolate = v8::Isolate::new(Default::default());
+  let profiler = v8::CpuProfiler::new(
+    &mut isolate,
+    v8::CpuProfilingNamingMode::StandardNaming,
+    v8::CpuProfilingLoggingMode::EagerLogging,
+  );
+  let other_isolate = &mut v8::Isolate::new(Default::default());
+  let profile = {
+    let scope = &mut v8::HandleScope::new(&mut isolate);
+    let running = v8::String::new(scope, "running").unwrap();
+    profiler.start_profiling(running, &Default::default());
+    let stopped = v8::String::new(scope, "stopped").unwrap();
+    profiler.start_profiling(stopped, &Default::default());
+    profiler.stop_profiling(stopped).unwrap()
+  };
+  assert!(profile.start_time().is_some());
+  assert!(profile.top_down_root(other_isolate).is_none());
+
+  // The isolate disposes the profiler, which is still recording, and the
+  // profile it owns.
+  drop(isolate);
+  assert!(profile.start_time().is_none());
+  assert!(profile.top_down_root(other_isolate).is_none());
+  assert!(profile.write_pprof(other_isolate, Vec::new()).is_err());
+  assert!(profiler.set_sampling_interval(100).is_none());
+  {
+    let scope = &mut v8::HandleScope::new(other_isolate);
+    assert!(profile.title(scope).is_none());
+    let title = v8::String::new(scope, "running").unwrap();
+    assert!(profiler
+      .start_profiling(title, &Default::default())
+      .is_none());
+    assert!(profiler.stop_profiling(title).is_none());
+  }
+  drop(profile);
+  drop(profiler);
+}
+
+#[test]
+fn sampling_heap_profiler() {
+  let _setup_guard = setup();
+  let isolate = &mut v8::Isolate::new(Default::default());
+  assert!(isolate.get_allocation_profile().is_none());
+  assert!(isolate.start_sampling_heap_profiler(1024, 16, false));
+  assert!(!isolate.start_sampling_heap_profiler(1024, 16, false));
+  {
+    let scope = &mut v8::HandleScope::new(isolate);
+    let context = v8::Context::new(scope);
+    let scope = &mut v8::ContextScope::new(scope, context);
+    let source = r#"
+      function allocateEyecatchers() {
+        const eyecatchers = [];
+        for (let i = 0; i < 1e5; i++) eyecatchers.push({ i });
+        return eyecatchers;
+      }
+      globalThis.eyecatchers = allocateEyecatchers();
+    "#;
+    eval(scope, source).unwrap();
+  }
+
+  let profile = isolate.get_allocation_profile().unwrap();
+  let mut found = false;
+  profile.root.walk(|path| {
+    let node = path.last().unwrap();
+    if node.name == "allocateEyecatchers" {
+      assert_eq!(node.line_number, 2);
+      let (count, size) = node.self_size();
+      assert!(count > 0);
+      assert!(size > 0);
+      found = true;
+    }
+  });
+  assert!(found);
+  let (count, size) = profile.root.total_size();
+  assert!(count > 0);
+  assert!(size > 0);
+  assert!(!profile.samples.is_empty());
+
+  let mut pprof = Vec::new();
+  profile.write_pprof(&mut pprof, 1024).unwrap();
+  let name = b"allocateEyecatchers";
+  assert!(pprof.windows(name.len()).any(|w| w == name));
+
+  isolate.stop_sampling_heap_profiler();
+  assert!(isolate.get_allocation_profile().is_none());
+}
+
+#[test]
+fn write_heap_snapshot() {
+  let _setup_guard = setup();
+  let isolate = &mut v8::Isolate::new(Default::default());
+  {
+    let scope = &mut v8::HandleScope::new(isolate);
+    let context = v8::Context::new(scope);
+    let scope = &mut v8::ContextScope::new(scope, context);
+    let source = r#"
+      {
+        class Eyecatcher {}
+        const eyecatchers = globalThis.eyecatchers = [];
+        for (let i = 0; i < 1e4; i++) eyecatchers.push(new Eyecatcher);
+      }
+    "#;
+    let _ = eval(scope, source).unwrap();
+  }
+
+  let options = v8::HeapSnapshotWriteOptions {
+    buffer_size: 4096,
+    max_buffers: 2,
+  };
+  let mut building = false;
+  let mut bytes_written = 0;
+  let json = isolate
+    .write_heap_snapshot(Vec::new(), &options, |progress| {
+      match progress {
+        v8::HeapSnapshotProgress::Building { done, total } => {
+          assert!(done <= total);
+          building = true;
+        }
+        v8::HeapSnapshotProgress::Writing {
+          bytes_in,
+          bytes_out,
+        } => {
+          assert!(bytes_out <= bytes_in);
+          bytes_written = bytes_in;
+        }
+      }
+      true
+    })
+    .unwrap();
+  assert!(building);
+  assert!(bytes_written > 0);
+  assert!(json.len() as u64 >= bytes_written);
+  let s = std::str::from_utf8(&json).unwrap();
+  assert!(s.contains("Eyecatcher"));
+
+  let error = isolate
+    .write_heap_snapshot(Vec::new(), &options, |progress| {
+      !matches!(progress, v8::HeapSnapshotProgress::Building { .. })
+    })
+    .unwrap_err();
+  assert_eq!(error.kind(), std::io::ErrorKind::Interrupted);
+
+  #[derive(Debug)]
+  struct FailingWriter;
+  impl std::io::Write for FailingWriter {
+    fn write(&mut self, _: &[u8]) -> std::io::Result<usize> {
+      Err(std::io::ErrorKind::WriteZero.into())
+    }
+    fn flush(&mut self) -> std::io::Result<()> {
+      Ok(())
+    }
+  }
+  let error = isolate
+    .write_heap_snapshot(FailingWriter, &options, |_| true)
+    .unwrap_err();
+  assert_eq!(error.kind(), std::io::ErrorKind::WriteZero);
+
+  let path = std::env::temp_dir()
+    .join(format!("rusty_v8_test_{}.heapsnapshot", std::process::id()));
+  let mut bytes_out = 0;
+  let size = isolate
+    .write_heap_snapshot_to_file(
+      &path,
+      v8::HeapSnapshotCompression::None,
+      &options,
+      |progress| {
+        if let v8::HeapSnapshotProgress::Writing { bytes_out: n, .. } = progress
+        {
+          bytes_out = n;
+        }
+        true
+      },
+    )
+    .unwrap();
+  assert!(bytes_out > 0 && bytes_out <= size);
+  let file = std::fs::read(&path).unwrap();
+  assert_eq!(file.len() as u64, size);
+  assert!(std::str::from_utf8(&file).unwrap().contains("Eyecatcher"));
+
+  #[cfg(feature = "gzip")]
+  {
+    let gzip_size = isolate
+      .write_heap_snapshot_to_file(
+        &path,
+        v8::HeapSnapshotCompression::Gzip(6),
+        &options,
+        |_| true,
+      )
+      .unwrap();
+    let file = std::fs::read(&path).unwrap();
+    assert_eq!(file.len() as u64, gzip_size);
+    assert_eq!(&file[..2], b"\x1f\x8b");
+    assert!(gzip_size < size);
+  }
+  std::fs::remove_file(&path).unwrap();
+}
+
+#[test]
+fn precise_coverage() {
+  let _setup_guard = setup();
+  let isolate = &mut v8::Isolate::new(Default::default());
+  assert!(isolate.take_precise_coverage().is_none());
+  isolate.select_coverage_mode(v8::CoverageMode::BlockCount);
+
+  let source = r#"
+    function covered(x) {
+      if (x) {
+        return 1;
+      }
+      return 2;
+    }
+    function uncovered() {
+      return 3;
+    }
+    for (let i = 0; i < 3; i++) covered(false);
+  "#;
+  {
+    let scope = &mut v8::HandleScope::new(isolate);
+    let context = v8::Context::new(scope);
+    let scope = &mut v8::ContextScope::new(scope, context);
+    let resource_name = v8::String::new(scope, "coverage.js").unwrap();
+    let source_map_url = v8::undefined(scope);
+    let origin = v8::ScriptOrigin::new(
+      scope,
+      resource_name.into(),
+      0,
+      0,
+      false,
+      0,
+      source_map_url.into(),
+      false,
+      false,
+      false,
+    );
+    let source = v8::String::new(scope, source).unwrap();
+    let script = v8::Script::compile(scope, source, Some(&origin)).unwrap();
+    script.run(scope).unwrap();
+  }
+
+  let coverage = isolate.take_precise_coverage().unwrap();
+  let script = coverage
+    .scripts
+    .iter()
+    .find(|script| script.url == "coverage.js")
+    .unwrap();
+  assert_eq!(script.line_ends.len(), source.lines().count());
+  let function =
+    |name: &str| script.functions.iter().find(|f| f.name == name).unwrap();
+  let covered = function("covered");
+  assert_eq!(covered.range.count, 3);
+  assert!(covered.has_block_coverage);
+  let block = covered.blocks.iter().find(|b| b.count == 0).unwrap();
+  let block_source =
+    &source[block.start_offset as usize..block.end_offset as usize];
+  assert!(block_source.contains("return 1"));
+  assert!(!block_source.contains("return 2"));
+  assert_eq!(script.line_number(covered.range.start_offset), 1);
+  assert_eq!(function("uncovered").range.count, 0);
+
+  let mut lcov = Vec::new();
+  coverage.write_lcov(&mut lcov).unwrap();
+  let lcov = String::from_utf8(lcov).unwrap();
+  assert!(lcov.contains("SF:coverage.js\n"));
+  assert!(lcov.contains("FN:2,covered\n"));
+  assert!(lcov.contains("FNDA:3,covered\n"));
+  assert!(lcov.contains("FNDA:0,uncovered\n"));
+  assert!(lcov.contains("DA:4,0\n"));
+  assert!(lcov.contains("DA:6,3\n"));
+  assert!(lcov.contains("DA:9,0\n"));
+  assert!(lcov.ends_with("end_of_record\n"));
+
+  // The counts were reset.
+  let coverage = isolate.take_precise_coverage().unwrap();
+  let script = coverage
+    .scripts
+    .iter()
+    .find(|script| script.url == "coverage.js")
+    .unwrap();
+  assert!(script.functions.iter().skip(1).all(|f| f.range.count == 0));
+}
+
 #[test]
 fn test_prototype_api() {
   let _setup_guard = setup();
@@ -4671,6 +5984,316 @@ fn value_serializer_not_implemented() {
   );
 }
 
+#[test]
+fn value_serializer_reset_keeps_settings() {
+  use v8::ValueSerializerHelper;
+
+  struct ViewsAsHostObjects;
+
+  impl v8::ValueSerializerImpl for ViewsAsHostObjects {
+    fn throw_data_clone_error<'s>(
+      &mut self,
+      scope: &mut v8::HandleScope<'s>,
+      message: v8::Local<'s, v8::String>,
+    ) {
+      let error = v8::Exception::error(scope, message);
+      scope.throw_exception(error);
+    }
+
+    fn write_host_object<'s>(
+      &mut self,
+      _scope: &mut v8::HandleScope<'s>,
+      object: v8::Local<'s, v8::Object>,
+      value_serializer: &mut dyn v8::ValueSerializerHelper,
+    ) -> Option<bool> {
+      let view = v8::Local::<v8::ArrayBufferView>::try_from(object).unwrap();
+      let mut contents = vec![0; view.byte_length()];
+      view.copy_contents(&mut contents);
+      value_serializer.write_uint32(contents.len() as u32);
+      value_serializer.write_raw_bytes(&contents);
+      Some(true)
+    }
+  }
+
+  let _setup_guard = setup();
+  let isolate = &mut v8::Isolate::new(Default::default());
+
+  let scope = &mut v8::HandleScope::new(isolate);
+
+  let context = v8::Context::new(scope);
+  let scope = &mut v8::ContextScope::new(scope, context);
+
+  let value = eval(scope, "new Uint8Array([1, 2, 3, 4])").unwrap();
+  let mut value_serializer =
+    v8::ValueSerializer::new(scope, Box::new(ViewsAsHostObjects));
+  value_serializer.set_treat_array_buffer_views_as_host_objects(true);
+  assert_eq!(value_serializer.write_value(context, value), Some(true));
+  let first = value_serializer.release_and_reset();
+  // The view is still passed to `write_host_object()` after the reset,
+  // rather than being written inline with its ArrayBuffer.
+  assert_eq!(value_serializer.write_value(context, value), Some(true));
+  let second = value_serializer.release_and_reset();
+  assert_eq!(first, second);
+  assert!(first.ends_with(&[4, 1, 2, 3, 4]));
+}
+
+#[test]
+fn value_serializer_reuse() {
+  let _setup_guard = setup();
+  let mut array_buffers = ArrayBuffers::new();
+  let isolate = &mut v8::Isolate::new(Default::default());
+
+  let scope = &mut v8::HandleScope::new(isolate);
+
+  let context = v8::Context::new(scope);
+  let scope = &mut v8::ContextScope::new(scope, context);
+
+  let shared: v8::Local<v8::Value> = eval(scope, "({ a: 1 })").unwrap();
+  let mut value_serializer =
+    Custom1Value::serializer(scope, &mut array_buffers);
+
+  // Serializing the same object after a reset must not produce a
+  // back-reference into the previous message.
+  let mut messages = vec![];
+  for _ in 0..3 {
+    assert_eq!(value_serializer.write_value(context, shared), Some(true));
+    messages.push(value_serializer.release_and_reset());
+  }
+  assert_eq!(messages[0], messages[1]);
+  assert_eq!(messages[1], messages[2]);
+
+  // A recycled buffer backs the next message.
+  let recycled = messages.pop().unwrap();
+  let recycled_ptr = recycled.as_ptr();
+  value_serializer.recycle_buffer(recycled);
+  assert_eq!(value_serializer.write_value(context, shared), Some(true));
+  let buffer = value_serializer.release_and_reset();
+  assert_eq!(buffer.as_ptr(), recycled_ptr);
+  assert_eq!(buffer, messages[0]);
+
+  // Data written before a reset is discarded.
+  assert_eq!(value_serializer.write_value(context, shared), Some(true));
+  value_serializer.reset();
+  assert!(value_serializer.release_and_reset().is_empty());
+  drop(value_serializer);
+
+  let mut value_deserializer =
+    Custom1Value::deserializer(scope, &buffer, &mut array_buffers);
+  let result = value_deserializer.read_value(context).unwrap();
+  drop(value_deserializer);
+  let name = v8::String::new(scope, "result").unwrap();
+  context.global(scope).set(scope, name.into(), result);
+  let result = eval(scope, "result.a === 1").unwrap();
+  assert!(result.is_true());
+}
+
+#[test]
+fn value_serializer_flush() {
+  use v8::ValueDeserializerHelper;
+  use v8::ValueSerializerHelper;
+
+  let _setup_guard = setup();
+  let mut array_buffers = ArrayBuffers::new();
+  let isolate = &mut v8::Isolate::new(Default::default());
+
+  let scope = &mut v8::HandleScope::new(isolate);
+
+  let context = v8::Context::new(scope);
+  let scope = &mut v8::ContextScope::new(scope, context);
+
+  let shared = eval(scope, "({ a: 1 })").unwrap();
+  let other = eval(scope, "'x'.repeat(1000)").unwrap();
+
+  let mut output = vec![];
+  let mut segments = 0;
+  {
+    let mut value_serializer =
+      Custom1Value::serializer(scope, &mut array_buffers);
+    value_serializer.write_header();
+    for value in &[shared, other, shared] {
+      assert_eq!(value_serializer.write_value(context, *value), Some(true));
+      let written = value_serializer.flush_to(&mut output).unwrap();
+      assert!(written > 0);
+      segments += 1;
+    }
+    assert!(value_serializer.take_buffer().is_empty());
+  }
+  assert_eq!(segments, 3);
+
+  let mut value_deserializer =
+    Custom1Value::deserializer(scope, &output, &mut array_buffers);
+  assert_eq!(value_deserializer.read_header(context), Some(true));
+  let first = value_deserializer.read_value(context).unwrap();
+  let second = value_deserializer.read_value(context).unwrap();
+  let third = value_deserializer.read_value(context).unwrap();
+  drop(value_deserializer);
+  assert!(first.is_object());
+  assert!(second.is_string());
+  // The third value was a back-reference into the first segment.
+  assert!(first.strict_equals(third));
+}
+
+struct Custom3Value {}
+
+impl v8::ValueSerializerImpl for Custom3Value {
+  #[allow(unused_variables)]
+  fn throw_data_clone_error<'s>(
+    &mut self,
+    scope: &mut v8::HandleScope<'s>,
+    message: v8::Local<'s, v8::String>,
+  ) {
+    let error = v8::Exception::error(scope, message);
+    scope.throw_exception(error);
+  }
+
+  fn write_host_object<'s>(
+    &mut self,
+    _scope: &mut v8::HandleScope<'s>,
+    object: v8::Local<'s, v8::Object>,
+    value_serializer: &mut dyn v8::ValueSerializerHelper,
+  ) -> Option<bool> {
+    let view = v8::Local::<v8::ArrayBufferView>::try_from(object).unwrap();
+    let mut contents = vec![0; view.byte_length()];
+    view.copy_contents(&mut contents);
+    value_serializer.write_uint32(contents.len() as u32);
+    value_serializer.write_raw_bytes(&contents);
+    Some(true)
+  }
+}
+
+impl v8::ValueDeserializerImpl for Custom3Value {
+  fn read_host_object<'s>(
+    &mut self,
+    scope: &mut v8::HandleScope<'s>,
+    value_deserializer: &mut dyn v8::ValueDeserializerHelper,
+  ) -> Option<v8::Local<'s, v8::Object>> {
+    let mut length = 0;
+    assert!(value_deserializer.read_uint32(&mut length));
+    let backing_store = value_deserializer
+      .read_raw_bytes_as_backing_store(length as usize)?
+      .make_shared();
+    let buffer = v8::ArrayBuffer::with_backing_store(scope, &backing_store);
+    let array = v8::Uint8Array::new(scope, buffer, 0, length as usize)?;
+    Some(array.into())
+  }
+}
+
+#[test]
+fn value_deserializer_shared_data() {
+  use v8::ValueSerializerHelper;
+
+  let _setup_guard = setup();
+  let isolate = &mut v8::Isolate::new(Default::default());
+
+  let scope = &mut v8::HandleScope::new(isolate);
+
+  let context = v8::Context::new(scope);
+  let scope = &mut v8::ContextScope::new(scope, context);
+
+  let value = eval(scope, "({ bytes: new Uint8Array([1, 2, 3, 4]) })").unwrap();
+  let mut value_serializer =
+    v8::ValueSerializer::new(scope, Box::new(Custom3Value {}));
+  value_serializer.set_treat_array_buffer_views_as_host_objects(true);
+  assert_eq!(value_serializer.write_value(context, value), Some(true));
+  let data = v8::ArrayBuffer::new_backing_store_from_boxed_slice(
+    value_serializer.release().into_boxed_slice(),
+  )
+  .make_shared();
+
+  let result = {
+    let mut value_deserializer = unsafe {
+      v8::ValueDeserializer::new_with_shared_data(
+        scope,
+        Box::new(Custom3Value {}),
+        data.clone(),
+      )
+    };
+    value_deserializer.read_value(context).unwrap()
+  };
+
+  let result = v8::Local::<v8::Object>::try_from(result).unwrap();
+  let name = v8::String::new(scope, "bytes").unwrap();
+  let bytes = result.get(scope, name.into()).unwrap();
+  let bytes = v8::Local::<v8::Uint8Array>::try_from(bytes).unwrap();
+  let backing_store = bytes.buffer(scope).unwrap().get_backing_store();
+  // The deserialized ArrayBuffer points into the input and keeps it alive.
+  let start = data.data() as *const u8;
+  let end = unsafe { start.add(data.byte_length()) };
+  let ptr = backing_store.data() as *const u8;
+  assert!(start <= ptr && ptr < end);
+  drop(data);
+  let contents: Vec<u8> = backing_store.iter().map(|b| b.get()).collect();
+  assert_eq!(contents, vec![1, 2, 3, 4]);
+}
+
+#[test]
+fn value_serializer_transfer_table() {
+  let _setup_guard = setup();
+  let buffer;
+  let mut transfer_table = v8::TransferTable::new();
+  {
+    let isolate = &mut v8::Isolate::new(Default::default());
+    let scope = &mut v8::HandleScope::new(isolate);
+    let context = v8::Context::new(scope);
+    let scope = &mut v8::ContextScope::new(scope, context);
+
+    let value = eval(
+      scope,
+      r#"
+        // MVP of WASM modules: contains only the magic marker and the version.
+        const bytes = new Uint8Array([0x00, 0x61, 0x73, 0x6d, 0x01, 0, 0, 0]);
+        ({
+          sab: new SharedArrayBuffer(4),
+          module: new WebAssembly.Module(bytes),
+        })
+      "#,
+    )
+    .unwrap();
+    let mut value_serializer =
+      v8::ValueSerializer::new(scope, Box::new(&mut transfer_table));
+    assert_eq!(value_serializer.write_value(context, value), Some(true));
+    buffer = value_serializer.release();
+  }
+
+  assert_eq!(transfer_table.shared_array_buffers().len(), 1);
+  assert_eq!(transfer_table.wasm_modules().len(), 1);
+  assert_eq!(
+    transfer_table.wasm_modules()[0].get_wire_bytes_ref(),
+    &[0x00, 0x61, 0x73, 0x6d, 0x01, 0x00, 0x00, 0x00]
+  );
+
+  // The table can be moved to the thread that owns the receiving isolate.
+  let mut transfer_table =
+    std::thread::spawn(move || transfer_table).join().unwrap();
+
+  {
+    let isolate = &mut v8::Isolate::new(Default::default());
+    let scope = &mut v8::HandleScope::new(isolate);
+    let context = v8::Context::new(scope);
+    let scope = &mut v8::ContextScope::new(scope, context);
+
+    let mut value_deserializer =
+      v8::ValueDeserializer::new(scope, Box::new(&mut transfer_table), &buffer);
+    let value = value_deserializer.read_value(context).unwrap();
+    drop(value_deserializer);
+    let name = v8::String::new(scope, "value").unwrap();
+    context.global(scope).set(scope, name.into(), value);
+    let result = eval(
+      scope,
+      r#"
+        new Uint8Array(value.sab)[2] = 42;
+        value.module instanceof WebAssembly.Module
+      "#,
+    )
+    .unwrap();
+    assert!(result.is_true());
+  }
+
+  // The SharedArrayBuffer shared its memory with the original one.
+  let backing_store = &transfer_table.shared_array_buffers()[0];
+  assert_eq!(backing_store[2].get(), 42);
+}
+
 #[test]
 fn clear_kept_objects() {
   let _setup_guard = setup();